@@ -5,5 +5,6 @@
 const char* WIFI_SSID = "YOUR_WIFI_NAME";
 const char* WIFI_PASSWORD = "YOUR_WIFI_PASSWORD";
 const char* THINGSPEAK_API_KEY = "YOUR_THINGSPEAK_API_KEY";
+const char* THINGSPEAK_CHANNEL_ID = "YOUR_THINGSPEAK_CHANNEL_ID";
 
 #endif
@@ -0,0 +1,10 @@
+# Host builds have no credentials; fall back to the example config.
+import os
+import shutil
+
+Import("env")
+
+project_dir = env.subst("$PROJECT_DIR")
+config = os.path.join(project_dir, "include", "config.h")
+if not os.path.exists(config):
+    shutil.copyfile(os.path.join(project_dir, "include", "config.example.h"), config)
@@ -0,0 +1,98 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include "WString.h"
+#include "Print.h"
+#include "Stream.h"
+#include "sim.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+// Host stand-in for the arduino-esp32 core, just enough for src/.
+
+#define RTC_DATA_ATTR
+#define RTC_NOINIT_ATTR
+#define IRAM_ATTR
+#define PROGMEM
+#define PGM_P const char*
+#define F(s) (s)
+
+#define BIT0 0x00000001
+#define BIT1 0x00000002
+#define BIT2 0x00000004
+#define BIT3 0x00000008
+#define pgm_read_byte(addr) (*(const uint8_t*)(addr))
+#define pgm_read_word(addr) (*(const uint16_t*)(addr))
+#define pgm_read_dword(addr) (*(const uint32_t*)(addr))
+#define pgm_read_ptr(addr) (*(void* const*)(addr))
+#define pgm_read_pointer(addr) (*(void* const*)(addr))
+#define pgm_read_float(addr) (*(const float*)(addr))
+
+#define LOW 0x0
+#define HIGH 0x1
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+#define INPUT_PULLDOWN 0x09
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+using std::abs;
+using std::isnan;
+using std::max;
+using std::min;
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+typedef enum {
+  ADC_0db,
+  ADC_2_5db,
+  ADC_6db,
+  ADC_11db
+} adc_attenuation_t;
+
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield();
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+
+void analogReadResolution(uint8_t bits);
+void analogSetAttenuation(adc_attenuation_t attenuation);
+uint16_t analogRead(uint8_t pin);
+uint32_t analogReadMilliVolts(uint8_t pin);
+float temperatureRead();
+
+class HardwareSerial : public Stream {
+  public:
+    void begin(unsigned long baud) { (void)baud; _open = true; }
+    void end() { _open = false; }
+    operator bool() const { return true; }
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buffer, size_t size) override;
+    using Print::write;
+  private:
+    bool _open = false;
+};
+extern HardwareSerial Serial;
+
+class EspClass {
+  public:
+    [[noreturn]] void restart();
+    uint32_t getFreeHeap();
+    uint32_t getMinFreeHeap();
+    uint32_t getCpuFreqMHz() { return 160; }
+};
+extern EspClass ESP;
@@ -0,0 +1,148 @@
+#pragma once
+#include <Adafruit_GFX.h>
+#include "Arduino.h"
+
+// In-memory stand-in for GxEPD2_BW driving a GDEM0397T81. Drawing follows
+// the real library (rotation, partial window, 1 = white buffer bits);
+// refreshes copy the window into sim::panel and charge the refresh time.
+
+#define GxEPD_BLACK 0x0000
+#define GxEPD_WHITE 0xFFFF
+
+namespace sim {
+// Physical panel content, row-major, MSB first, 1 = white.
+struct Panel {
+  static const uint16_t WIDTH = 800;
+  static const uint16_t HEIGHT = 480;
+  uint8_t pixels[WIDTH / 8 * HEIGHT];
+  uint32_t fullRefreshes;
+  uint32_t partialRefreshes;
+  bool powered;
+};
+extern Panel panel;
+// Copies the window to the panel and returns when the BUSY line drops again.
+uint64_t epdRefreshBegin(const uint8_t* buffer, uint16_t x, uint16_t y, uint16_t w, uint16_t h, bool partial);
+void epdRefreshEnd();
+void epdPower(bool on);
+void epdAttachBusyPin(int16_t pin);
+bool writePanelPbm(const char* path);
+}
+
+class GxEPD2_397_GDEM0397T81 {
+  public:
+    static const uint16_t WIDTH = 800;
+    static const uint16_t WIDTH_VISIBLE = WIDTH;
+    static const uint16_t HEIGHT = 480;
+    static const bool hasPartialUpdate = true;
+    static const uint16_t full_refresh_time = sim::timing::EPD_FULL_REFRESH;
+    static const uint16_t partial_refresh_time = sim::timing::EPD_PARTIAL_REFRESH;
+
+    GxEPD2_397_GDEM0397T81(int16_t cs, int16_t dc, int16_t rst, int16_t busy) { (void)cs; (void)dc; (void)rst; sim::epdAttachBusyPin(busy); }
+    void setBusyCallback(void (*busyCallback)(const void*), const void* busy_callback_parameter = 0) {
+      _busyCallback = busyCallback;
+      _busyCallbackParameter = busy_callback_parameter;
+    }
+
+    void (*_busyCallback)(const void*) = nullptr;
+    const void* _busyCallbackParameter = nullptr;
+};
+
+template <typename GxEPD2_Type, const uint16_t page_height>
+class GxEPD2_BW : public Adafruit_GFX {
+  public:
+    GxEPD2_Type epd2;
+
+    GxEPD2_BW(GxEPD2_Type epd2_instance) : Adafruit_GFX(GxEPD2_Type::WIDTH, GxEPD2_Type::HEIGHT), epd2(epd2_instance) {
+      setFullWindow();
+    }
+
+    void init(uint32_t serial_diag_bitrate = 0, bool initial = true, uint16_t reset_duration = 10, bool pulldown_rst_mode = false) {
+      (void)serial_diag_bitrate; (void)reset_duration; (void)pulldown_rst_mode;
+      _initial = initial;
+      sim::epdPower(true);
+      setFullWindow();
+    }
+
+    void drawPixel(int16_t x, int16_t y, uint16_t color) override {
+      if ((x < 0) || (x >= width()) || (y < 0) || (y >= height())) return;
+      switch (getRotation()) {
+        case 1: std::swap(x, y); x = WIDTH - x - 1; break;
+        case 2: x = WIDTH - x - 1; y = HEIGHT - y - 1; break;
+        case 3: std::swap(x, y); y = HEIGHT - y - 1; break;
+      }
+      x -= _pw_x;
+      y -= _pw_y;
+      if ((x < 0) || (x >= int16_t(_pw_w)) || (y < 0) || (y >= int16_t(_pw_h))) return;
+      uint32_t i = x / 8 + uint32_t(y) * (_pw_w / 8);
+      if (color) _buffer[i] = (_buffer[i] | (1 << (7 - x % 8)));
+      else _buffer[i] = (_buffer[i] & (0xFF ^ (1 << (7 - x % 8))));
+    }
+
+    void fillScreen(uint16_t color) override {
+      memset(_buffer, color == GxEPD_BLACK ? 0x00 : 0xFF, sizeof(_buffer));
+    }
+
+    void setFullWindow() {
+      _using_partial_mode = false;
+      _pw_x = 0;
+      _pw_y = 0;
+      _pw_w = WIDTH;
+      _pw_h = HEIGHT;
+    }
+
+    void setPartialWindow(uint16_t x, uint16_t y, uint16_t w, uint16_t h) {
+      if (!GxEPD2_Type::hasPartialUpdate) return;
+      int16_t rx = x, ry = y, rw = w, rh = h;
+      rotate(rx, ry, rw, rh);
+      _using_partial_mode = true;
+      _pw_x = std::min<int16_t>(std::max<int16_t>(rx, 0), WIDTH);
+      _pw_y = std::min<int16_t>(std::max<int16_t>(ry, 0), HEIGHT);
+      _pw_w = std::min<int16_t>(rw, WIDTH - _pw_x);
+      _pw_h = std::min<int16_t>(rh, HEIGHT - _pw_y);
+      // make _pw_x, _pw_w multiple of 8
+      _pw_w += _pw_x % 8;
+      if (_pw_w % 8 > 0) _pw_w += 8 - _pw_w % 8;
+      _pw_x -= _pw_x % 8;
+      _pw_w = std::min<uint16_t>(_pw_w, WIDTH - _pw_x);
+    }
+
+    void firstPage() { fillScreen(GxEPD_WHITE); }
+
+    bool nextPage() {
+      refresh();
+      return false;
+    }
+
+    void display(bool partial_update_mode = false) {
+      (void)partial_update_mode;
+      refresh();
+    }
+
+    void powerOff() { sim::epdPower(false); }
+    void hibernate() { sim::epdPower(false); }
+
+  private:
+    uint8_t _buffer[(GxEPD2_Type::WIDTH / 8) * page_height];
+    bool _using_partial_mode = false;
+    bool _initial = true;
+    uint16_t _pw_x, _pw_y, _pw_w, _pw_h;
+
+    void rotate(int16_t& x, int16_t& y, int16_t& w, int16_t& h) {
+      switch (getRotation()) {
+        case 1: std::swap(x, y); std::swap(w, h); x = WIDTH - x - w; break;
+        case 2: x = WIDTH - x - w; y = HEIGHT - y - h; break;
+        case 3: std::swap(x, y); std::swap(w, h); y = HEIGHT - y - h; break;
+      }
+    }
+
+    void refresh() {
+      uint64_t busyUntil = sim::epdRefreshBegin(_buffer, _pw_x, _pw_y, _pw_w, _pw_h, _using_partial_mode);
+      // _waitWhileBusy()
+      sim::Activity activity("epd refresh");
+      while (sim::nowUs() < busyUntil) {
+        if (epd2._busyCallback) epd2._busyCallback(epd2._busyCallbackParameter);
+        else delay(1);
+      }
+      sim::epdRefreshEnd();
+    }
+};
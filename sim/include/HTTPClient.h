@@ -0,0 +1,73 @@
+#pragma once
+#include "Arduino.h"
+#include "WiFi.h"
+
+#define HTTPC_ERROR_CONNECTION_REFUSED (-1)
+#define HTTPC_ERROR_SEND_HEADER_FAILED (-2)
+#define HTTPC_ERROR_NOT_CONNECTED (-4)
+#define HTTPC_ERROR_READ_TIMEOUT (-11)
+
+namespace sim {
+struct HttpResponse {
+  int code;
+  String body;
+  String date;  // the Date header
+};
+// Serves a request against the simulated internet and charges its time.
+// With `socketOpen` the caller's client already connected (and did any TLS),
+// and the response is delivered to that socket.
+HttpResponse httpRequest(const char* method, const String& url, const String& payload, uint32_t timeoutMs, uint32_t connectTimeoutMs, bool socketOpen = false);
+}
+
+class HTTPClient {
+  public:
+    bool begin(const String& url) { _url = url; return true; }
+    bool begin(WiFiClient& client, const String& url) { _client = &client; _url = url; return true; }
+    void end() { if (_client != &_ownClient) _client->stop(); }
+    void setTimeout(uint16_t timeout) { _timeoutMs = timeout; }
+    void setConnectTimeout(int32_t timeout) { _connectTimeoutMs = timeout; }
+    void setReuse(bool reuse) { (void)reuse; }
+    void useHTTP10(bool usehttp10) { (void)usehttp10; }
+    void addHeader(const String& name, const String& value) { (void)name; (void)value; }
+    // Only Date is ever sent back.
+    void collectHeaders(const char* headerKeys[], const size_t headerKeysCount) {
+      _collectDate = false;
+      for (size_t i = 0; i < headerKeysCount; i++) _collectDate |= strcasecmp(headerKeys[i], "Date") == 0;
+    }
+    String header(const char* name) { return _collectDate && strcasecmp(name, "Date") == 0 ? _date : String(); }
+
+    int GET() { return send("GET", String()); }
+    int POST(const String& payload) { return send("POST", payload); }
+    int POST(const uint8_t* payload, size_t size) { return send("POST", String(std::string(reinterpret_cast<const char*>(payload), size))); }
+
+    int getSize() { return static_cast<int>(_response.length()); }
+    String getString() { return _response; }
+    WiFiClient& getStream() { return *_client; }
+    WiFiClient* getStreamPtr() { return _client; }
+
+  private:
+    String _url;
+    String _response;
+    String _date;
+    bool _collectDate = false;
+    uint32_t _timeoutMs = 5000;
+    int32_t _connectTimeoutMs = 5000;
+    WiFiClient _ownClient;
+    WiFiClient* _client = &_ownClient;
+
+    // A client passed to begin() is connected first, as HTTPClient does.
+    int send(const char* method, const String& payload) {
+      bool external = _client != &_ownClient;
+      if (external) {
+        int hostStart = _url.indexOf("://") + 3;
+        int hostEnd = _url.indexOf('/', hostStart);
+        String host = _url.substring(hostStart, hostEnd < 0 ? _url.length() : hostEnd);
+        if (!_client->connect(host.c_str(), _url.startsWith("https://") ? 443 : 80, _connectTimeoutMs)) return HTTPC_ERROR_CONNECTION_REFUSED;
+      }
+      sim::HttpResponse response = sim::httpRequest(method, _url, payload, _timeoutMs, _connectTimeoutMs, external);
+      _response = response.body;
+      _date = response.date;
+      if (!external) _client->reset(_response.c_str(), _response.length());
+      return response.code;
+    }
+};
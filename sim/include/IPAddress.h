@@ -0,0 +1,21 @@
+#pragma once
+#include "Arduino.h"
+
+class IPAddress {
+  public:
+    IPAddress() : _address(0) {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : _address(a | (b << 8) | (c << 16) | (uint32_t(d) << 24)) {}
+    IPAddress(uint32_t address) : _address(address) {}
+    operator uint32_t() const { return _address; }
+    uint8_t operator[](int index) const { return (_address >> (index * 8)) & 0xFF; }
+    bool operator==(const IPAddress& other) const { return _address == other._address; }
+    String toString() const {
+      char buf[16];
+      snprintf(buf, sizeof(buf), "%u.%u.%u.%u", (*this)[0], (*this)[1], (*this)[2], (*this)[3]);
+      return String(buf);
+    }
+  private:
+    uint32_t _address;
+};
+
+const IPAddress INADDR_NONE(0, 0, 0, 0);
@@ -0,0 +1,27 @@
+#pragma once
+#include "Wire.h"
+
+#define SCD40_I2C_ADDR_62 0x62
+#define SCD41_I2C_ADDR_62 0x62
+
+// Mirrors the SensirionI2cScd4x 1.x API; the sensor itself is modelled in sim/src/hardware.cpp.
+class SensirionI2cScd4x {
+  public:
+    void begin(TwoWire& i2cBus, uint8_t i2cAddress) { (void)i2cBus; _address = i2cAddress; }
+
+    int16_t startPeriodicMeasurement();
+    int16_t startLowPowerPeriodicMeasurement();
+    int16_t stopPeriodicMeasurement();
+    int16_t readMeasurement(uint16_t& co2Concentration, float& temperature, float& relativeHumidity);
+    int16_t getDataReadyStatus(bool& arg0);
+    int16_t setAmbientPressure(uint32_t ambientPressure);
+    int16_t performForcedRecalibration(uint16_t targetCO2Concentration, uint16_t& frcCorrection);
+    int16_t measureSingleShot();
+    int16_t measureSingleShotRhtOnly();
+    int16_t powerDown();
+    int16_t wakeUp();
+    int16_t reinit();
+
+  private:
+    uint8_t _address = SCD40_I2C_ADDR_62;
+};
@@ -0,0 +1,52 @@
+#pragma once
+#include "Print.h"
+
+class Stream : public Print {
+  public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+
+    void setTimeout(unsigned long timeout) { _timeout = timeout; }
+    unsigned long getTimeout() const { return _timeout; }
+
+    virtual size_t readBytes(char* buffer, size_t length) {
+      size_t count = 0;
+      while (count < length) {
+        int c = read();
+        if (c < 0) break;
+        *buffer++ = static_cast<char>(c);
+        count++;
+      }
+      return count;
+    }
+    size_t readBytes(uint8_t* buffer, size_t length) { return readBytes(reinterpret_cast<char*>(buffer), length); }
+
+  protected:
+    unsigned long _timeout = 1000;
+};
+
+// Stream over a caller-owned buffer; what HTTPClient::getStream() hands out.
+class MemoryStream : public Stream {
+  public:
+    MemoryStream() {}
+    MemoryStream(const char* data, size_t size) { reset(data, size); }
+    void reset(const char* data, size_t size) { _data = data; _size = size; _pos = 0; }
+
+    int available() override { return static_cast<int>(_size - _pos); }
+    int read() override { return _pos < _size ? static_cast<uint8_t>(_data[_pos++]) : -1; }
+    int peek() override { return _pos < _size ? static_cast<uint8_t>(_data[_pos]) : -1; }
+    using Stream::readBytes;
+    size_t readBytes(char* buffer, size_t length) override {
+      size_t n = std::min(length, _size - _pos);
+      memcpy(buffer, _data + _pos, n);
+      _pos += n;
+      return n;
+    }
+    size_t write(uint8_t) override { return 0; }
+
+  private:
+    const char* _data = nullptr;
+    size_t _size = 0;
+    size_t _pos = 0;
+};
@@ -0,0 +1,91 @@
+#pragma once
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <string>
+
+class __FlashStringHelper;
+
+// Subset of the Arduino String used by the firmware and ArduinoJson.
+class String {
+  public:
+    String() {}
+    String(const char* s) { if (s) _s = s; }
+    String(const std::string& s) : _s(s) {}
+    String(char c) : _s(1, c) {}
+    String(int v, unsigned char base = 10) { fromLong(v, base); }
+    String(unsigned int v, unsigned char base = 10) { fromUnsigned(v, base); }
+    String(long v, unsigned char base = 10) { fromLong(v, base); }
+    String(unsigned long v, unsigned char base = 10) { fromUnsigned(v, base); }
+    String(float v, unsigned int decimals = 2) { fromDouble(v, decimals); }
+    String(double v, unsigned int decimals = 2) { fromDouble(v, decimals); }
+
+    String& operator=(const char* s) { _s = s ? s : ""; return *this; }
+
+    unsigned int length() const { return _s.size(); }
+    const char* c_str() const { return _s.c_str(); }
+    bool reserve(unsigned int size) { _s.reserve(size); return true; }
+    bool concat(const char* s) { if (s) _s += s; return true; }
+    bool concat(const String& s) { _s += s._s; return true; }
+    bool concat(char c) { _s += c; return true; }
+
+    String& operator+=(const String& s) { _s += s._s; return *this; }
+    String& operator+=(const char* s) { if (s) _s += s; return *this; }
+    String& operator+=(char c) { _s += c; return *this; }
+
+    friend String operator+(const String& a, const String& b) { return String(a._s + b._s); }
+    friend String operator+(const String& a, const char* b) { return String(a._s + b); }
+    friend String operator+(const char* a, const String& b) { return String(a + b._s); }
+
+    bool operator==(const String& o) const { return _s == o._s; }
+    bool operator==(const char* o) const { return _s == o; }
+    bool operator!=(const String& o) const { return _s != o._s; }
+    char operator[](unsigned int i) const { return i < _s.size() ? _s[i] : 0; }
+    char charAt(unsigned int i) const { return (*this)[i]; }
+
+    String substring(unsigned int from) const { return substring(from, length()); }
+    String substring(unsigned int from, unsigned int to) const {
+      if (from > to) std::swap(from, to);
+      if (from >= _s.size()) return String();
+      return String(_s.substr(from, to - from));
+    }
+    int indexOf(char c, unsigned int from = 0) const {
+      size_t i = _s.find(c, from);
+      return i == std::string::npos ? -1 : int(i);
+    }
+    int indexOf(const char* s, unsigned int from = 0) const {
+      size_t i = _s.find(s, from);
+      return i == std::string::npos ? -1 : int(i);
+    }
+    bool startsWith(const char* s) const { return _s.compare(0, strlen(s), s) == 0; }
+    bool endsWith(const char* s) const { size_t n = strlen(s); return _s.size() >= n && _s.compare(_s.size() - n, n, s) == 0; }
+    long toInt() const { return atol(_s.c_str()); }
+    float toFloat() const { return atof(_s.c_str()); }
+    void toCharArray(char* buf, unsigned int bufsize, unsigned int index = 0) const {
+      if (!bufsize || !buf) return;
+      size_t n = index < _s.size() ? std::min<size_t>(bufsize - 1, _s.size() - index) : 0;
+      memcpy(buf, _s.c_str() + index, n);
+      buf[n] = 0;
+    }
+
+  private:
+    std::string _s;
+
+    void fromLong(long v, unsigned char base) {
+      if (base == 10) { char buf[24]; snprintf(buf, sizeof(buf), "%ld", v); _s = buf; }
+      else fromUnsigned(static_cast<unsigned long>(v), base);
+    }
+    void fromUnsigned(unsigned long v, unsigned char base) {
+      char buf[72];
+      char* p = buf + sizeof(buf) - 1;
+      *p = 0;
+      do { *--p = "0123456789abcdefghijklmnopqrstuvwxyz"[v % base]; v /= base; } while (v);
+      _s = p;
+    }
+    void fromDouble(double v, unsigned int decimals) {
+      char buf[48];
+      snprintf(buf, sizeof(buf), "%.*f", static_cast<int>(decimals), v);
+      _s = buf;
+    }
+};
@@ -0,0 +1,109 @@
+#pragma once
+#include "Arduino.h"
+#include "IPAddress.h"
+
+typedef enum {
+  WL_IDLE_STATUS = 0,
+  WL_NO_SSID_AVAIL = 1,
+  WL_SCAN_COMPLETED = 2,
+  WL_CONNECTED = 3,
+  WL_CONNECT_FAILED = 4,
+  WL_CONNECTION_LOST = 5,
+  WL_DISCONNECTED = 6
+} wl_status_t;
+
+typedef enum {
+  WIFI_OFF = 0,
+  WIFI_STA = 1,
+  WIFI_AP = 2,
+  WIFI_AP_STA = 3
+} wifi_mode_t;
+
+typedef enum {
+  WIFI_PS_NONE,
+  WIFI_PS_MIN_MODEM,
+  WIFI_PS_MAX_MODEM
+} wifi_ps_type_t;
+
+typedef enum {
+  WIFI_POWER_19_5dBm = 78,
+  WIFI_POWER_19dBm = 76,
+  WIFI_POWER_18_5dBm = 74,
+  WIFI_POWER_17dBm = 68,
+  WIFI_POWER_15dBm = 60,
+  WIFI_POWER_13dBm = 52,
+  WIFI_POWER_11dBm = 44,
+  WIFI_POWER_8_5dBm = 34,
+  WIFI_POWER_7dBm = 28,
+  WIFI_POWER_5dBm = 20,
+  WIFI_POWER_2dBm = 8,
+  WIFI_POWER_MINUS_1dBm = -4
+} wifi_power_t;
+
+class WiFiClass {
+  public:
+    bool mode(wifi_mode_t mode);
+    void persistent(bool persistent) { (void)persistent; }
+    bool setTxPower(wifi_power_t power) { (void)power; return true; }
+    bool setSleep(bool enabled) { (void)enabled; return true; }
+    bool setSleep(wifi_ps_type_t type) { (void)type; return true; }
+    bool config(IPAddress localIP, IPAddress gateway, IPAddress subnet, IPAddress dns1 = IPAddress(), IPAddress dns2 = IPAddress());
+    wl_status_t begin(const char* ssid, const char* passphrase = nullptr, int32_t channel = 0, const uint8_t* bssid = nullptr, bool connect = true);
+    wl_status_t status();
+    bool disconnect(bool wifioff = false, bool eraseap = false);
+    bool isConnected() { return status() == WL_CONNECTED; }
+
+    uint8_t* BSSID();
+    int32_t channel();
+    int8_t RSSI();
+    IPAddress localIP();
+    IPAddress gatewayIP();
+    IPAddress subnetMask();
+    IPAddress dnsIP(uint8_t index = 0);
+};
+extern WiFiClass WiFi;
+
+// Response body of the last simulated HTTP exchange, readable as a Stream.
+// connect() opens a socket to a simulated host, which then receives the
+// response of the next HTTP exchange with it.
+class WiFiClient : public MemoryStream {
+  public:
+    virtual ~WiFiClient();
+    virtual int connect(const char* host, uint16_t port) { return connect(host, port, 3000); }
+    virtual int connect(const char* host, uint16_t port, int32_t timeout);
+    virtual void stop();
+    virtual uint8_t connected() { return sim::nowUs() < _arrivesAtUs || available() > 0; }
+    int available() override { return sim::nowUs() < _arrivesAtUs ? 0 : MemoryStream::available(); }
+    virtual void flush() {}
+    using MemoryStream::read;
+    virtual int read(uint8_t* buffer, size_t size) {
+      int n = static_cast<int>(MemoryStream::readBytes(reinterpret_cast<char*>(buffer), size));
+      return n > 0 ? n : -1;
+    }
+    // As the real WiFiClient: bulk reads go through read(buffer, size).
+    using MemoryStream::readBytes;
+    size_t readBytes(char* buffer, size_t length) override {
+      size_t count = 0;
+      while (count < length) {
+        int n = read(reinterpret_cast<uint8_t*>(buffer) + count, length - count);
+        if (n <= 0) break;
+        count += n;
+      }
+      return count;
+    }
+    using Print::write;
+    size_t write(uint8_t) override { return 1; }
+
+    // Response bytes arriving on the socket.
+    void receive(const String& data) { receiveAt(0, data); }
+    // Same, once the simulated clock reaches `atUs`.
+    void receiveAt(uint64_t atUs, const String& data) {
+      _received = data;
+      _arrivesAtUs = atUs;
+      reset(_received.c_str(), _received.length());
+    }
+
+  private:
+    String _received;
+    uint64_t _arrivesAtUs = 0;
+};
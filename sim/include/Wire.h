@@ -0,0 +1,39 @@
+#pragma once
+#include "Arduino.h"
+
+namespace sim {
+// A device on the simulated I2C bus. Commands arrive as whole transmissions.
+class I2cDevice {
+  public:
+    virtual ~I2cDevice() {}
+    virtual bool onTransmission(const uint8_t* data, size_t length) = 0;
+    virtual size_t onRequest(uint8_t* data, size_t length) { (void)data; (void)length; return 0; }
+};
+void attachI2cDevice(uint8_t address, I2cDevice* device);
+}
+
+class TwoWire : public Stream {
+  public:
+    bool begin(int sda = -1, int scl = -1, uint32_t frequency = 0);
+    void setClock(uint32_t frequency) { (void)frequency; }
+
+    void beginTransmission(uint8_t address);
+    uint8_t endTransmission(bool sendStop = true);
+    size_t requestFrom(uint8_t address, size_t size, bool sendStop = true);
+
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* data, size_t size) override;
+    using Print::write;
+    int available() override { return static_cast<int>(_rxLength - _rxIndex); }
+    int read() override { return _rxIndex < _rxLength ? _rx[_rxIndex++] : -1; }
+    int peek() override { return _rxIndex < _rxLength ? _rx[_rxIndex] : -1; }
+
+  private:
+    uint8_t _address = 0;
+    uint8_t _tx[32];
+    size_t _txLength = 0;
+    uint8_t _rx[32];
+    size_t _rxLength = 0;
+    size_t _rxIndex = 0;
+};
+extern TwoWire Wire;
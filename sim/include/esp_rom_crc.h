@@ -0,0 +1,12 @@
+#pragma once
+#include <cstdint>
+
+// The ROM's CRC-32 (IEEE 802.3, reflected), bit by bit.
+inline uint32_t esp_rom_crc32_le(uint32_t crc, uint8_t const* buf, uint32_t len) {
+  crc = ~crc;
+  while (len--) {
+    crc ^= *buf++;
+    for (int bit = 0; bit < 8; bit++) crc = (crc >> 1) ^ (0xEDB88320u & -(crc & 1));
+  }
+  return ~crc;
+}
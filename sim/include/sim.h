@@ -0,0 +1,152 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <ctime>
+
+/**
+ * Host simulator for the wake cycle.
+ *
+ * Time is virtual: delay(), sensor conversions, WiFi association, HTTP
+ * transfers and e-paper refreshes advance a simulated clock instead of
+ * sleeping. Every component reports its supply current, and the clock
+ * integrates charge as it advances, so each run gives a repeatable time
+ * and charge figure per wake.
+**/
+namespace sim {
+
+enum Component {
+  COMPONENT_CPU,
+  COMPONENT_RADIO,
+  COMPONENT_SCD40,
+  COMPONENT_SENSORS,
+  COMPONENT_EPD,
+  COMPONENT_COUNT
+};
+
+// Supply currents in mA. Datasheet typicals, calibrate against a USB meter.
+namespace current {
+  const float CPU_ACTIVE = 24.0f;        // ESP32-C3 @ 160 MHz, radio off
+  const float CPU_LIGHT_SLEEP = 0.13f;
+  const float CPU_DEEP_SLEEP = 0.005f;
+  const float BOARD_QUIESCENT = 0.02f;   // regulator + divider, always on
+  const float RADIO_ACTIVE = 154.0f;     // on top of CPU, WIFI_PS_NONE @ 5 dBm (docs/WiFi strength.md)
+  const float SCD40_MEASURING = 15.0f;
+  const float SCD40_IDLE = 0.2f;
+  const float SENSORS_MEASURING = 0.5f;  // AHT20 / BMP280 conversion
+  const float EPD_REFRESH = 6.0f;
+  const float EPD_IDLE = 0.02f;
+}
+
+// Durations in ms used by the hardware models.
+namespace timing {
+  const uint32_t WIFI_SCAN = 650;        // scan + auth + assoc + DHCP = 1260 ms (docs/WiFi strength.md, 5 dBm)
+  const uint32_t WIFI_ASSOCIATE = 150;
+  const uint32_t WIFI_DHCP = 460;
+  const uint32_t DNS_LOOKUP = 30;
+  const uint32_t TCP_CONNECT = 40;
+  const uint32_t TLS_HANDSHAKE = 1100;     // ECDHE + certificate chain on the C3
+  const uint32_t TLS_RESUME = 180;         // one round trip, symmetric crypto only
+  const uint32_t HTTP_SERVER = 120;
+  const uint32_t HTTP_BYTES_PER_MS = 100;
+  const uint32_t SCD40_CONVERSION = 5000;
+  const uint32_t SCD40_STOP = 500;
+  const uint32_t SCD40_FRC = 400;
+  const uint32_t AHT_CONVERSION = 80;
+  const uint32_t BMP_CONVERSION = 14;
+  const uint32_t EPD_FULL_REFRESH = 3000;
+  const uint32_t EPD_PARTIAL_REFRESH = 800;
+}
+
+const float BATTERY_VOLTAGE = 3.7f;
+
+// Thrown by esp_deep_sleep_start() / ESP.restart() to unwind setup().
+struct DeepSleep {
+  uint64_t sleepUs;
+};
+
+// Virtual time.
+uint64_t nowUs();        // since the start of the simulation
+uint64_t bootUs();       // since the current wake started (millis() base)
+// Unix time of the simulated clock. The forecast server reports it as local
+// time, so its hour of day is the one the panel should show.
+time_t wallClock();
+// Spends `us` in the calling task; other tasks run in the meantime.
+void advanceUs(uint64_t us);
+inline void advanceMs(uint32_t ms) { advanceUs(uint64_t(ms) * 1000); }
+// Spends `us` with every task halted (light sleep).
+void haltUs(uint64_t us);
+
+/**
+ * Cooperative tasks on the virtual clock. Each task is a host thread, but
+ * only one runs at a time: control passes whenever the running one waits,
+ * to whichever task is due first.
+**/
+struct Task;
+Task* spawnTask(void (*function)(void*), void* parameter, const char* name);
+[[noreturn]] void exitTask();
+// Waits until `wakeAtUs` or until notify(waitObject), whichever comes first.
+void blockUntil(uint64_t wakeAtUs, const void* waitObject);
+void notify(const void* waitObject);
+// Ends every task but the main one, as deep sleep would.
+void killTasks();
+const uint64_t FOREVER = UINT64_MAX;
+
+// Charge accounting.
+void setCurrent(Component component, float mA);
+float getCurrent(Component component);
+
+/**
+ * Labels the virtual time spent while it is alive, e.g. "scd40" or
+ * "http:api.open-meteo.com". Nested activities attribute to the innermost.
+**/
+class Activity {
+  public:
+    explicit Activity(const char* label);
+    ~Activity();
+  private:
+    const char* _previous;
+};
+
+/**
+ * TLS stand-in server behind every HTTPS host. A full handshake issues a
+ * session ticket, which resumes later handshakes until it expires or the
+ * ticket key is rotated; a declined ticket falls back to a full handshake
+ * in the same exchange, as RFC 5077 servers do.
+**/
+struct TlsServer {
+  uint32_t ticketKey = 1;               // change to invalidate issued tickets
+  uint32_t ticketLifetimeS = 18 * 3600;
+  bool abortOnTicket = false;           // fail handshakes that offer a ticket
+  uint32_t flightDelayMs = 0;           // ServerHello and certificates arrive this late
+  uint32_t fullHandshakes = 0;
+  uint32_t resumedHandshakes = 0;
+};
+TlsServer& tlsServer(const char* host);
+// Serves one handshake and charges its time. Returns 0 and writes a new
+// ticket (up to 64 bytes), or a negative mbedTLS error.
+int tlsHandshake(const char* host, const uint8_t* ticket, size_t ticketLength, uint8_t* newTicket, size_t* newTicketLength);
+
+// Wake cycle bookkeeping, driven by the simulator main().
+void beginWake();
+void endWake(uint64_t sleepUs);
+void printWakeReport();
+void printSummary();
+uint32_t wakeCount();
+// Figures of the last finished wake.
+uint64_t lastWakeAwakeUs();
+uint64_t lastWakeRadioUs();  // time the radio drew current
+double lastWakeChargeMc();   // charge drawn while awake
+
+// Access point availability, for outage scenarios. While it is down,
+// WiFi.begin() keeps the radio scanning and never connects.
+void setAccessPointUp(bool up);
+// Readings ThingSpeak has accepted in bulk updates.
+uint32_t uploadedReadings();
+// Extra time every HTTP server takes to respond, for stall scenarios.
+void setServerStallMs(uint32_t ms);
+// Extra time every TCP connect takes, up to the caller's connect timeout.
+void setConnectStallMs(uint32_t ms);
+// Forecasts Open-Meteo has delivered.
+uint32_t forecastResponses();
+
+}
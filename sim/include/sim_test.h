@@ -0,0 +1,34 @@
+#pragma once
+#include <cstdio>
+#include "sim.h"
+
+/**
+ * Helpers shared by the host tests in test/
+ *
+ * runWake() needs the firmware linked in; tests of a single module only
+ * use expect().
+**/
+
+void setup();
+void loop();
+
+namespace sim {
+
+// One wake cycle of the firmware, from setup() until it goes to deep sleep.
+inline void runWake() {
+  beginWake();
+  try {
+    setup();
+    for (;;) loop();
+  } catch (const DeepSleep& sleep) {
+    endWake(sleep.sleepUs);
+  }
+}
+
+// Prints one check of a test, returns `ok`.
+inline bool expect(bool ok, const char* what) {
+  printf("%-60s %s\n", what, ok ? "ok" : "FAILED");
+  return ok;
+}
+
+}
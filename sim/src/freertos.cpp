@@ -0,0 +1,67 @@
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/event_groups.h>
+#include "sim.h"
+
+struct SimEventGroup {
+  EventBits_t bits;
+};
+
+static uint64_t ticksToUs(TickType_t ticks) {
+  return uint64_t(ticks) * 1000000 / configTICK_RATE_HZ;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t pvTaskCode, const char* pcName, uint32_t usStackDepth, void* pvParameters, UBaseType_t uxPriority, TaskHandle_t* pxCreatedTask) {
+  (void)usStackDepth; (void)uxPriority;
+  sim::Task* task = sim::spawnTask(pvTaskCode, pvParameters, pcName);
+  if (pxCreatedTask) *pxCreatedTask = reinterpret_cast<TaskHandle_t>(task);
+  return pdPASS;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t pvTaskCode, const char* pcName, uint32_t usStackDepth, void* pvParameters, UBaseType_t uxPriority, TaskHandle_t* pxCreatedTask, BaseType_t xCoreID) {
+  (void)xCoreID;
+  return xTaskCreate(pvTaskCode, pcName, usStackDepth, pvParameters, uxPriority, pxCreatedTask);
+}
+
+// Only self-deletion is modelled, which is all the firmware uses.
+void vTaskDelete(TaskHandle_t xTaskToDelete) {
+  (void)xTaskToDelete;
+  sim::exitTask();
+}
+
+void vTaskDelay(TickType_t xTicksToDelay) { sim::advanceUs(ticksToUs(xTicksToDelay)); }
+
+TickType_t xTaskGetTickCount() { return static_cast<TickType_t>(sim::bootUs() / (1000000 / configTICK_RATE_HZ)); }
+
+EventGroupHandle_t xEventGroupCreate() { return new SimEventGroup{0}; }
+
+void vEventGroupDelete(EventGroupHandle_t xEventGroup) { delete xEventGroup; }
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t xEventGroup, EventBits_t uxBitsToSet) {
+  xEventGroup->bits |= uxBitsToSet;
+  sim::notify(xEventGroup);
+  return xEventGroup->bits;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t xEventGroup, EventBits_t uxBitsToClear) {
+  EventBits_t before = xEventGroup->bits;
+  xEventGroup->bits &= ~uxBitsToClear;
+  return before;
+}
+
+EventBits_t xEventGroupGetBits(EventGroupHandle_t xEventGroup) { return xEventGroup->bits; }
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t xEventGroup, EventBits_t uxBitsToWaitFor, BaseType_t xClearOnExit, BaseType_t xWaitForAllBits, TickType_t xTicksToWait) {
+  uint64_t deadlineUs = xTicksToWait == portMAX_DELAY ? sim::FOREVER : sim::nowUs() + ticksToUs(xTicksToWait);
+  for (;;) {
+    EventBits_t bits = xEventGroup->bits;
+    EventBits_t matched = bits & uxBitsToWaitFor;
+    bool done = xWaitForAllBits ? matched == uxBitsToWaitFor : matched != 0;
+    if (done) {
+      if (xClearOnExit) xEventGroup->bits &= ~uxBitsToWaitFor;
+      return bits;
+    }
+    if (sim::nowUs() >= deadlineUs) return bits;
+    sim::blockUntil(deadlineUs, xEventGroup);
+  }
+}
@@ -0,0 +1,3 @@
+// Adafruit GFX is installed for this environment but kept out of the library
+// build (its SPI/OLED drivers need a real core); only the canvas code is used.
+#include <Adafruit_GFX.cpp>
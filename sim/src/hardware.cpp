@@ -0,0 +1,985 @@
+// Behavioural models of the board peripherals behind the shim headers.
+#include <Arduino.h>
+#include <Wire.h>
+#include <WiFi.h>
+#include <HTTPClient.h>
+#include <Adafruit_AHTX0.h>
+#include <Adafruit_BMP280.h>
+#include <SensirionI2CScd4x.h>
+#include <GxEPD2_BW.h>
+#include <esp_sleep.h>
+#include <driver/gpio.h>
+#include <mbedtls/ssl.h>
+#include <mbedtls/entropy.h>
+#include <mbedtls/ctr_drbg.h>
+#include <cmath>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include "../../src/PinConfig.h"
+
+namespace sim {
+
+// Simulated calendar start: 2026-10-17 00:00 UTC.
+const time_t EPOCH_START = 1792195200;
+
+time_t wallClock() { return EPOCH_START + static_cast<time_t>(nowUs() / 1000000); }
+static float hourOfDay() { return static_cast<float>((wallClock() % 86400) / 3600.0); }
+
+// Interned labels for Activity, which keeps the pointer.
+static const char* label(const std::string& text) {
+  static std::set<std::string> labels;
+  return labels.insert(text).first->c_str();
+}
+
+// ################################ Core #######################################
+
+static uint8_t pinLevels[32];
+static uint64_t sleepTimerUs = 0;
+static bool gpioWakeupEnabled = false;
+static uint32_t wakeOnLow = 0, wakeOnHigh = 0;  // pin masks of gpio_wakeup_enable()
+static uint64_t untilPinLevelUs(uint8_t pin, uint8_t level);
+
+}
+
+HardwareSerial Serial;
+EspClass ESP;
+TwoWire Wire;
+WiFiClass WiFi;
+
+unsigned long millis() { return static_cast<unsigned long>(sim::bootUs() / 1000); }
+unsigned long micros() { return static_cast<unsigned long>(sim::bootUs()); }
+void delay(uint32_t ms) { sim::advanceMs(ms); }
+void delayMicroseconds(uint32_t us) { sim::advanceUs(us); }
+void yield() {}
+
+void pinMode(uint8_t pin, uint8_t mode) { (void)pin; (void)mode; }
+void digitalWrite(uint8_t pin, uint8_t val) { if (pin < 32) sim::pinLevels[pin] = val; }
+
+void analogReadResolution(uint8_t bits) { (void)bits; }
+void analogSetAttenuation(adc_attenuation_t attenuation) { (void)attenuation; }
+uint16_t analogRead(uint8_t pin) { return static_cast<uint16_t>(analogReadMilliVolts(pin) * 4095 / 3100); }
+
+uint32_t analogReadMilliVolts(uint8_t pin) {
+  sim::advanceUs(40);
+  if (pin == POWER_SENSING_PIN) return static_cast<uint32_t>(sim::BATTERY_VOLTAGE * 1000.0f / VOLTAGE_DIVIDER_RATIO);
+  return 0;
+}
+
+float temperatureRead() { return 38.5f; }
+
+size_t HardwareSerial::write(uint8_t c) { return fwrite(&c, 1, 1, stdout); }
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size) { return fwrite(buffer, 1, size, stdout); }
+
+void EspClass::restart() { throw sim::DeepSleep{0}; }
+uint32_t EspClass::getFreeHeap() { return 240 * 1024; }
+uint32_t EspClass::getMinFreeHeap() { return 240 * 1024; }
+
+esp_err_t esp_sleep_enable_timer_wakeup(uint64_t time_in_us) {
+  sim::sleepTimerUs = time_in_us;
+  return ESP_OK;
+}
+
+esp_err_t esp_sleep_enable_gpio_wakeup() {
+  sim::gpioWakeupEnabled = true;
+  return ESP_OK;
+}
+
+esp_err_t esp_sleep_disable_wakeup_source(esp_sleep_source_t source) {
+  if (source == ESP_SLEEP_WAKEUP_TIMER || source == ESP_SLEEP_WAKEUP_ALL) sim::sleepTimerUs = sim::FOREVER;
+  if (source == ESP_SLEEP_WAKEUP_GPIO || source == ESP_SLEEP_WAKEUP_ALL) sim::gpioWakeupEnabled = false;
+  return ESP_OK;
+}
+
+esp_err_t gpio_wakeup_enable(gpio_num_t gpio_num, gpio_int_type_t intr_type) {
+  if (gpio_num < 0 || gpio_num >= 32 || (intr_type != GPIO_INTR_LOW_LEVEL && intr_type != GPIO_INTR_HIGH_LEVEL)) return -1;
+  (intr_type == GPIO_INTR_LOW_LEVEL ? sim::wakeOnLow : sim::wakeOnHigh) |= 1u << gpio_num;
+  return ESP_OK;
+}
+
+esp_err_t gpio_wakeup_disable(gpio_num_t gpio_num) {
+  if (gpio_num < 0 || gpio_num >= 32) return -1;
+  sim::wakeOnLow &= ~(1u << gpio_num);
+  sim::wakeOnHigh &= ~(1u << gpio_num);
+  return ESP_OK;
+}
+
+esp_err_t esp_light_sleep_start() {
+  sim::Activity activity("light sleep");
+  float cpu = sim::getCurrent(sim::COMPONENT_CPU);
+  sim::setCurrent(sim::COMPONENT_CPU, sim::current::CPU_LIGHT_SLEEP);
+  uint64_t sleepUs = sim::sleepTimerUs;
+  for (uint8_t pin = 0; sim::gpioWakeupEnabled && pin < 32; pin++) {
+    if (sim::wakeOnLow & (1u << pin)) sleepUs = std::min(sleepUs, sim::untilPinLevelUs(pin, LOW));
+    if (sim::wakeOnHigh & (1u << pin)) sleepUs = std::min(sleepUs, sim::untilPinLevelUs(pin, HIGH));
+  }
+  sim::haltUs(sleepUs);
+  sim::setCurrent(sim::COMPONENT_CPU, cpu);
+  return ESP_OK;
+}
+
+void esp_deep_sleep_start() { throw sim::DeepSleep{sim::sleepTimerUs}; }
+
+esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause() {
+  return sim::wakeCount() > 1 ? ESP_SLEEP_WAKEUP_TIMER : ESP_SLEEP_WAKEUP_UNDEFINED;
+}
+
+// ################################ I2C ########################################
+
+namespace sim {
+static std::map<uint8_t, I2cDevice*>& i2cDevices() {
+  static std::map<uint8_t, I2cDevice*> devices;
+  return devices;
+}
+void attachI2cDevice(uint8_t address, I2cDevice* device) { i2cDevices()[address] = device; }
+}
+
+bool TwoWire::begin(int sda, int scl, uint32_t frequency) { (void)sda; (void)scl; (void)frequency; return true; }
+
+void TwoWire::beginTransmission(uint8_t address) {
+  _address = address;
+  _txLength = 0;
+}
+
+size_t TwoWire::write(uint8_t c) {
+  if (_txLength >= sizeof(_tx)) return 0;
+  _tx[_txLength++] = c;
+  return 1;
+}
+
+size_t TwoWire::write(const uint8_t* data, size_t size) {
+  size_t n = 0;
+  while (n < size && write(data[n])) n++;
+  return n;
+}
+
+uint8_t TwoWire::endTransmission(bool sendStop) {
+  (void)sendStop;
+  sim::advanceUs(100 + _txLength * 90);  // 100 kHz bus
+  auto it = sim::i2cDevices().find(_address);
+  if (it == sim::i2cDevices().end()) return 2;  // address NACK
+  return it->second->onTransmission(_tx, _txLength) ? 0 : 3;
+}
+
+size_t TwoWire::requestFrom(uint8_t address, size_t size, bool sendStop) {
+  (void)sendStop;
+  _rxIndex = 0;
+  _rxLength = 0;
+  sim::advanceUs(100 + size * 90);
+  auto it = sim::i2cDevices().find(address);
+  if (it == sim::i2cDevices().end()) return 0;
+  _rxLength = it->second->onRequest(_rx, std::min(size, sizeof(_rx)));
+  return _rxLength;
+}
+
+// ############################### Sensors #####################################
+
+bool Adafruit_AHTX0::begin(TwoWire* wire, int32_t sensor_id, uint8_t i2c_address) {
+  (void)wire; (void)sensor_id; (void)i2c_address;
+  sim::advanceMs(20);  // soft reset + calibration check
+  return true;
+}
+
+bool Adafruit_AHTX0::getEvent(sensors_event_t* humidity, sensors_event_t* temp) {
+  sim::Activity activity("aht20");
+  sim::setCurrent(sim::COMPONENT_SENSORS, sim::current::SENSORS_MEASURING);
+  sim::advanceMs(sim::timing::AHT_CONVERSION);
+  sim::setCurrent(sim::COMPONENT_SENSORS, 0);
+  float hour = sim::hourOfDay();
+  temp->temperature = 21.5f + 1.5f * sinf((hour - 15.0f) / 24.0f * 2.0f * static_cast<float>(M_PI));
+  humidity->relative_humidity = 45.0f - 5.0f * sinf((hour - 15.0f) / 24.0f * 2.0f * static_cast<float>(M_PI));
+  return true;
+}
+
+bool Adafruit_BMP280::begin(uint8_t addr, uint8_t chipid) {
+  (void)addr; (void)chipid;
+  sim::advanceMs(2);
+  _present = true;
+  return true;
+}
+
+void Adafruit_BMP280::setSampling(sensor_mode mode, sensor_sampling tempSampling, sensor_sampling pressSampling, sensor_filter filter, standby_duration duration) {
+  (void)mode; (void)tempSampling; (void)pressSampling; (void)filter; (void)duration;
+  sim::advanceUs(300);
+}
+
+bool Adafruit_BMP280::takeForcedMeasurement() {
+  sim::Activity activity("bmp280");
+  sim::setCurrent(sim::COMPONENT_SENSORS, sim::current::SENSORS_MEASURING);
+  sim::advanceMs(sim::timing::BMP_CONVERSION);
+  sim::setCurrent(sim::COMPONENT_SENSORS, 0);
+  return true;
+}
+
+float Adafruit_BMP280::readTemperature() { return 22.0f; }
+float Adafruit_BMP280::readPressure() { return 98650.0f + 150.0f * sinf(sim::hourOfDay() / 24.0f * 2.0f * static_cast<float>(M_PI)); }
+
+// ################################ SCD40 ######################################
+
+namespace sim {
+
+// SCD40 state machine, driven both by the Sensirion driver shim and by raw
+// commands written to 0x62.
+class Scd40 : public I2cDevice {
+  public:
+    enum State { IDLE, PERIODIC, SINGLE_SHOT, SLEEPING };
+
+    Scd40() { attachI2cDevice(SCD40_I2C_ADDR_62, this); setCurrent(COMPONENT_SCD40, current::SCD40_IDLE); }
+
+    int16_t command(uint16_t code) {
+      switch (code) {
+        case 0x21B1:  // start_periodic_measurement
+          if (_state != IDLE) return ERROR;
+          enter(PERIODIC, timing::SCD40_CONVERSION);
+          return 0;
+        case 0x3F86:  // stop_periodic_measurement
+          if (_state == SLEEPING) return ERROR;
+          enter(IDLE, 0);
+          return 0;
+        case 0x219D:  // measure_single_shot
+          if (_state != IDLE) return ERROR;
+          enter(SINGLE_SHOT, timing::SCD40_CONVERSION);
+          return 0;
+        case 0x2196:  // measure_single_shot_rht_only
+          if (_state != IDLE) return ERROR;
+          enter(SINGLE_SHOT, 50);
+          _rhtOnly = true;
+          return 0;
+        case 0x36E0:  // power_down
+          if (_state != IDLE) return ERROR;
+          _state = SLEEPING;
+          setCurrent(COMPONENT_SCD40, 0.0f);
+          return 0;
+        case 0x36F6:  // wake_up
+          if (_state == SLEEPING) {
+            _state = IDLE;
+            _firstAfterWake = true;
+            setCurrent(COMPONENT_SCD40, current::SCD40_IDLE);
+          }
+          return 0;
+      }
+      return ERROR;
+    }
+
+    bool dataReady() {
+      settle();
+      return _hasData;
+    }
+
+    int16_t read(uint16_t& co2, float& temperature, float& humidity) {
+      if (!dataReady()) return ERROR;
+      _hasData = false;
+      float hour = hourOfDay();
+      co2 = _rhtOnly ? 0 : static_cast<uint16_t>(650.0f + 250.0f * sinf((hour - 20.0f) / 24.0f * 2.0f * static_cast<float>(M_PI)));
+      if (_firstAfterWake && !_rhtOnly) co2 += 120;  // first conversion after wake_up is off
+      _firstAfterWake = false;
+      _rhtOnly = false;
+      temperature = 22.0f;
+      humidity = 44.0f;
+      return 0;
+    }
+
+    void setPowered(bool powered) {
+      _state = powered ? IDLE : SLEEPING;
+      _firstAfterWake = powered;
+      setCurrent(COMPONENT_SCD40, powered ? current::SCD40_IDLE : 0.0f);
+    }
+
+    bool onTransmission(const uint8_t* data, size_t length) override {
+      if (length < 2) return false;
+      return command(static_cast<uint16_t>(data[0] << 8 | data[1])) == 0 || data[0] == 0x36;
+    }
+
+  private:
+    static const int16_t ERROR = 0x0204;  // NACK from the driver's point of view
+    State _state = IDLE;
+    uint64_t _readyAtUs = 0;
+    bool _hasData = false;
+    bool _rhtOnly = false;
+    bool _firstAfterWake = false;
+
+    void enter(State state, uint32_t conversionMs) {
+      _state = state;
+      _hasData = false;
+      _readyAtUs = nowUs() + uint64_t(conversionMs) * 1000;
+      setCurrent(COMPONENT_SCD40, state == IDLE ? current::SCD40_IDLE : current::SCD40_MEASURING);
+    }
+
+    // Completes conversions whose time has come.
+    void settle() {
+      if ((_state == PERIODIC || _state == SINGLE_SHOT) && nowUs() >= _readyAtUs) {
+        _hasData = true;
+        if (_state == SINGLE_SHOT) {
+          _state = IDLE;
+          setCurrent(COMPONENT_SCD40, current::SCD40_IDLE);
+        } else {
+          _readyAtUs += uint64_t(timing::SCD40_CONVERSION) * 1000;
+        }
+      }
+    }
+};
+
+static Scd40 scd40Sensor;
+static Scd40& scd40() { return scd40Sensor; }
+
+}
+
+int16_t SensirionI2cScd4x::startPeriodicMeasurement() { sim::advanceMs(1); return sim::scd40().command(0x21B1); }
+int16_t SensirionI2cScd4x::startLowPowerPeriodicMeasurement() { sim::advanceMs(1); return sim::scd40().command(0x21B1); }
+
+int16_t SensirionI2cScd4x::stopPeriodicMeasurement() {
+  int16_t error = sim::scd40().command(0x3F86);
+  sim::advanceMs(sim::timing::SCD40_STOP);
+  return error;
+}
+
+int16_t SensirionI2cScd4x::readMeasurement(uint16_t& co2Concentration, float& temperature, float& relativeHumidity) {
+  sim::advanceMs(2);
+  return sim::scd40().read(co2Concentration, temperature, relativeHumidity);
+}
+
+int16_t SensirionI2cScd4x::getDataReadyStatus(bool& arg0) {
+  sim::advanceMs(2);
+  arg0 = sim::scd40().dataReady();
+  return 0;
+}
+
+int16_t SensirionI2cScd4x::setAmbientPressure(uint32_t ambientPressure) { (void)ambientPressure; sim::advanceMs(1); return 0; }
+
+int16_t SensirionI2cScd4x::performForcedRecalibration(uint16_t targetCO2Concentration, uint16_t& frcCorrection) {
+  (void)targetCO2Concentration;
+  sim::advanceMs(sim::timing::SCD40_FRC);
+  frcCorrection = 0x8000;
+  return 0;
+}
+
+int16_t SensirionI2cScd4x::measureSingleShot() {
+  int16_t error = sim::scd40().command(0x219D);
+  sim::advanceMs(sim::timing::SCD40_CONVERSION);
+  return error;
+}
+
+int16_t SensirionI2cScd4x::measureSingleShotRhtOnly() {
+  int16_t error = sim::scd40().command(0x2196);
+  sim::advanceMs(50);
+  return error;
+}
+
+int16_t SensirionI2cScd4x::powerDown() { sim::advanceMs(1); return sim::scd40().command(0x36E0); }
+int16_t SensirionI2cScd4x::wakeUp() { sim::scd40().command(0x36F6); sim::advanceMs(30); return 0; }
+int16_t SensirionI2cScd4x::reinit() { sim::advanceMs(30); return 0; }
+
+// ################################ WiFi #######################################
+
+namespace sim {
+
+static struct {
+  bool started = false;
+  uint64_t connectedAtUs = 0;
+  bool staticIp = false;
+  bool apUp = true;
+} wifi;
+
+static uint8_t AP_BSSID[6] = {0x9c, 0x53, 0x22, 0x1a, 0x40, 0x7e};
+static const int32_t AP_CHANNEL = 6;
+
+static void radio(bool on) { setCurrent(COMPONENT_RADIO, on ? current::RADIO_ACTIVE : 0.0f); }
+
+void setAccessPointUp(bool up) { wifi.apUp = up; }
+
+}
+
+bool WiFiClass::mode(wifi_mode_t mode) {
+  if (mode == WIFI_OFF) {
+    sim::wifi.started = false;
+    sim::radio(false);
+  }
+  return true;
+}
+
+bool WiFiClass::config(IPAddress localIP, IPAddress gateway, IPAddress subnet, IPAddress dns1, IPAddress dns2) {
+  (void)gateway; (void)subnet; (void)dns1; (void)dns2;
+  sim::wifi.staticIp = uint32_t(localIP) != 0;
+  return true;
+}
+
+wl_status_t WiFiClass::begin(const char* ssid, const char* passphrase, int32_t channel, const uint8_t* bssid, bool connect) {
+  (void)ssid; (void)passphrase;
+  if (!connect) return WL_DISCONNECTED;
+  uint32_t ms = sim::timing::WIFI_ASSOCIATE;
+  bool knownAp = bssid && channel == sim::AP_CHANNEL && memcmp(bssid, sim::AP_BSSID, 6) == 0;
+  if (!knownAp) ms += sim::timing::WIFI_SCAN;
+  if (!sim::wifi.staticIp) ms += sim::timing::WIFI_DHCP;
+  sim::wifi.started = true;
+  sim::wifi.connectedAtUs = sim::nowUs() + uint64_t(ms) * 1000;
+  sim::radio(true);
+  return WL_DISCONNECTED;
+}
+
+wl_status_t WiFiClass::status() {
+  if (!sim::wifi.started) return WL_DISCONNECTED;
+  if (!sim::wifi.apUp) return WL_NO_SSID_AVAIL;
+  return sim::nowUs() >= sim::wifi.connectedAtUs ? WL_CONNECTED : WL_DISCONNECTED;
+}
+
+bool WiFiClass::disconnect(bool wifioff, bool eraseap) {
+  (void)eraseap;
+  sim::wifi.started = false;
+  sim::wifi.staticIp = false;
+  if (wifioff) sim::radio(false);
+  return true;
+}
+
+uint8_t* WiFiClass::BSSID() { return status() == WL_CONNECTED ? sim::AP_BSSID : nullptr; }
+int32_t WiFiClass::channel() { return sim::AP_CHANNEL; }
+int8_t WiFiClass::RSSI() { return status() == WL_CONNECTED ? -67 : 0; }
+IPAddress WiFiClass::localIP() { return status() == WL_CONNECTED ? IPAddress(192, 168, 1, 57) : IPAddress(); }
+IPAddress WiFiClass::gatewayIP() { return status() == WL_CONNECTED ? IPAddress(192, 168, 1, 1) : IPAddress(); }
+IPAddress WiFiClass::subnetMask() { return status() == WL_CONNECTED ? IPAddress(255, 255, 255, 0) : IPAddress(); }
+IPAddress WiFiClass::dnsIP(uint8_t index) { (void)index; return status() == WL_CONNECTED ? IPAddress(192, 168, 1, 1) : IPAddress(); }
+
+// ################################ HTTP #######################################
+
+namespace sim {
+
+static int queryInt(const String& url, const char* key, int fallback) {
+  int at = url.indexOf(key);
+  if (at < 0) return fallback;
+  return static_cast<int>(url.substring(at + strlen(key)).toInt());
+}
+
+// Open-Meteo shaped forecast for the hours following the simulated clock.
+// Local time is the simulated UTC clock, reported with a +2 h offset.
+// Like icon_d2, a model run every 3 h is out 2 h later and reaches 48 h;
+// hours past the latest one are NaN, null in JSON.
+struct ForecastModel {
+  static const int UTC_OFFSET = 7200;
+  static const int RUN_INTERVAL = 3 * 3600;
+  static const int RUN_DELAY = 2 * 3600;
+  static const int RUN_HOURS = 48;
+  time_t start;  // first hour, local
+  std::vector<float> temp, rain, snow;
+  std::vector<time_t> sunrise, sunset;  // local, one per day from the first hour's
+};
+
+static ForecastModel forecastModel(const String& url) {
+  ForecastModel m;
+  int hours = queryInt(url, "forecast_hours=", 24);
+  m.start = wallClock() / 3600 * 3600;
+  time_t run = (wallClock() - ForecastModel::RUN_DELAY) / ForecastModel::RUN_INTERVAL * ForecastModel::RUN_INTERVAL;
+  for (int i = 0; i < hours; i++) {
+    if (m.start + i * 3600 >= run + ForecastModel::RUN_HOURS * 3600) {
+      m.temp.push_back(NAN);
+      m.rain.push_back(NAN);
+      m.snow.push_back(NAN);
+      continue;
+    }
+    int hour = static_cast<int>((m.start + i * 3600) % 86400 / 3600);
+    m.temp.push_back(roundf(10.0f * (9.0f + 6.0f * sinf((hour - 9.0f) / 24.0f * 2.0f * static_cast<float>(M_PI)))) / 10.0f);
+    m.rain.push_back((hour >= 14 && hour <= 18) ? roundf(4.0f * (hour - 13)) / 10.0f : 0.0f);
+    m.snow.push_back(0.0f);
+  }
+  int days = queryInt(url, "forecast_days=", 1);
+  for (int d = 0; d < days; d++) {
+    time_t day = m.start / 86400 * 86400 + d * 86400;
+    m.sunrise.push_back(day + 7 * 3600 + 21 * 60);
+    m.sunset.push_back(day + 18 * 3600 + 12 * 60);
+  }
+  return m;
+}
+
+// Array element `i`, null for NaN.
+static std::string jsonNumber(size_t i, const char* format, float value) {
+  char buf[16] = "null";
+  if (!std::isnan(value)) snprintf(buf, sizeof(buf), format, value);
+  return (i ? "," : "") + std::string(buf);
+}
+
+static String forecastJson(const ForecastModel& m) {
+  std::string times, temps, rain, snow;
+  char buf[32];
+  for (size_t i = 0; i < m.temp.size(); i++) {
+    time_t t = m.start + i * 3600;
+    struct tm tm;
+    gmtime_r(&t, &tm);
+    strftime(buf, sizeof(buf), "\"%Y-%m-%dT%H:00\"", &tm);
+    times += (i ? "," : "") + std::string(buf);
+    temps += jsonNumber(i, "%.1f", m.temp[i]);
+    rain += jsonNumber(i, "%.1f", m.rain[i]);
+    snow += jsonNumber(i, "%.2f", m.snow[i]);
+  }
+  std::string dates, sunrises, sunsets;
+  for (size_t d = 0; d < m.sunrise.size(); d++) {
+    struct tm tm;
+    gmtime_r(&m.sunrise[d], &tm);
+    strftime(buf, sizeof(buf), "\"%Y-%m-%d\"", &tm);
+    dates += (d ? "," : "") + std::string(buf);
+    strftime(buf, sizeof(buf), "\"%Y-%m-%dT%H:%M\"", &tm);
+    sunrises += (d ? "," : "") + std::string(buf);
+    gmtime_r(&m.sunset[d], &tm);
+    strftime(buf, sizeof(buf), "\"%Y-%m-%dT%H:%M\"", &tm);
+    sunsets += (d ? "," : "") + std::string(buf);
+  }
+  std::string body = "{\"latitude\":50.06,\"longitude\":14.42,\"generationtime_ms\":0.06,\"utc_offset_seconds\":7200,"
+    "\"timezone\":\"Europe/Berlin\",\"timezone_abbreviation\":\"GMT+2\",\"elevation\":250.0,"
+    "\"hourly_units\":{\"time\":\"iso8601\",\"temperature_2m\":\"°C\",\"rain\":\"mm\",\"snowfall\":\"cm\"},"
+    "\"hourly\":{\"time\":[" + times + "],\"temperature_2m\":[" + temps + "],\"rain\":[" + rain + "],\"snowfall\":[" + snow + "]},"
+    "\"daily_units\":{\"time\":\"iso8601\",\"sunset\":\"iso8601\",\"sunrise\":\"iso8601\"},"
+    "\"daily\":{\"time\":[" + dates + "],\"sunset\":[" + sunsets + "],\"sunrise\":[" + sunrises + "]}}";
+  return String(body);
+}
+
+// Minimal FlatBuffers writer, laid out front to back: every table is
+// preceded by its vtable and followed by the objects it references, so all
+// uoffsets point forward as the format requires.
+class FlatBufferWriter {
+  public:
+    std::string buf;
+
+    size_t align(size_t alignment, size_t extra = 0) {
+      while ((buf.size() + extra) % alignment) buf += '\0';
+      return buf.size();
+    }
+    template <typename T> size_t put(T value) {
+      size_t at = buf.size();
+      buf.append(reinterpret_cast<const char*>(&value), sizeof(T));
+      return at;
+    }
+    template <typename T> void patch(size_t at, T value) { memcpy(&buf[at], &value, sizeof(T)); }
+    void link(size_t from, size_t to) { patch<uint32_t>(from, static_cast<uint32_t>(to - from)); }
+
+    // Writes a table referenced from the uoffset at `from`, whose fields (in
+    // vtable order) have the given sizes, 0 for absent. Returns the field
+    // positions.
+    std::vector<size_t> table(size_t from, const std::vector<uint8_t>& sizes) {
+      size_t inlineSize = 4;
+      std::vector<uint16_t> offsets;
+      for (uint8_t size : sizes) {
+        if (size == 0) { offsets.push_back(0); continue; }
+        while (inlineSize % size) inlineSize++;
+        offsets.push_back(static_cast<uint16_t>(inlineSize));
+        inlineSize += size;
+      }
+      size_t vtable = align(2);
+      put<uint16_t>(static_cast<uint16_t>(4 + 2 * sizes.size()));
+      put<uint16_t>(static_cast<uint16_t>(inlineSize));
+      for (uint16_t offset : offsets) put<uint16_t>(offset);
+      size_t start = align(8);
+      put<int32_t>(static_cast<int32_t>(start - vtable));
+      link(from, start);
+      buf.append(inlineSize - 4, '\0');
+      std::vector<size_t> fields;
+      for (uint16_t offset : offsets) fields.push_back(offset ? start + offset : 0);
+      return fields;
+    }
+    template <typename T> void vector(size_t from, const std::vector<T>& values) {
+      align(sizeof(T) > 4 ? 8 : 4, 4);
+      link(from, put<uint32_t>(static_cast<uint32_t>(values.size())));
+      for (T value : values) put<T>(value);
+    }
+};
+
+// WeatherApiResponse from the openmeteo_sdk schema, one size-prefixed message.
+static String forecastFlatBuffer(const ForecastModel& m) {
+  FlatBufferWriter w;
+  w.put<uint32_t>(0);  // size prefix
+  size_t root = w.put<uint32_t>(0);
+  // latitude, longitude, elevation, generation_time_ms, location_id, model, utc_offset_seconds, timezone, timezone_abbreviation, current, daily, hourly
+  std::vector<size_t> response = w.table(root, {4, 4, 4, 4, 0, 0, 4, 0, 0, 0, 4, 4});
+  w.patch<float>(response[0], 50.06f);
+  w.patch<float>(response[1], 14.42f);
+  w.patch<float>(response[2], 250.0f);
+  w.patch<float>(response[3], 0.05f);
+  w.patch<int32_t>(response[6], ForecastModel::UTC_OFFSET);
+
+  // VariablesWithTime: time, time_end, interval, variables
+  auto variablesWithTime = [&](size_t field, int64_t time, int64_t timeEnd, int32_t interval, size_t count) {
+    std::vector<size_t> t = w.table(field, {8, 8, 4, 4});
+    w.patch<int64_t>(t[0], time);
+    w.patch<int64_t>(t[1], timeEnd);
+    w.patch<int32_t>(t[2], interval);
+    w.align(4);
+    w.link(t[3], w.put<uint32_t>(static_cast<uint32_t>(count)));
+    std::vector<size_t> elements;
+    for (size_t i = 0; i < count; i++) elements.push_back(w.put<uint32_t>(0));
+    return elements;
+  };
+  // VariableWithValues: variable, unit, value, values, values_int64. The
+  // firmware goes by request order, so the variable/unit enums are left out.
+  auto floatVariable = [&](size_t element, const std::vector<float>& values) {
+    std::vector<size_t> v = w.table(element, {0, 0, 0, 4, 0});
+    w.vector(v[3], values);
+  };
+  auto int64Variable = [&](size_t element, const std::vector<time_t>& local) {
+    std::vector<int64_t> values;
+    for (time_t t : local) values.push_back(t - ForecastModel::UTC_OFFSET);
+    std::vector<size_t> v = w.table(element, {0, 0, 0, 0, 4});
+    w.vector(v[4], values);
+  };
+
+  int64_t hourlyStart = m.start - ForecastModel::UTC_OFFSET;
+  // Variables in request order: temperature_2m, rain, snowfall.
+  std::vector<size_t> hourly = variablesWithTime(response[11], hourlyStart, hourlyStart + 3600 * int64_t(m.temp.size()), 3600, 3);
+  floatVariable(hourly[0], m.temp);
+  floatVariable(hourly[1], m.rain);
+  floatVariable(hourly[2], m.snow);
+
+  // daily=sunset,sunrise
+  int64_t dayStart = m.start / 86400 * 86400 - ForecastModel::UTC_OFFSET;
+  std::vector<size_t> daily = variablesWithTime(response[10], dayStart, dayStart + 86400 * int64_t(m.sunrise.size()), 86400, 2);
+  int64Variable(daily[0], m.sunset);
+  int64Variable(daily[1], m.sunrise);
+
+  w.patch<uint32_t>(0, static_cast<uint32_t>(w.buf.size() - 4));
+  return String(w.buf);
+}
+
+static uint32_t thingSpeakReadings = 0;
+uint32_t uploadedReadings() { return thingSpeakReadings; }
+
+static uint32_t serverStallMs = 0;
+void setServerStallMs(uint32_t ms) { serverStallMs = ms; }
+
+static uint32_t connectStallMs = 0;
+void setConnectStallMs(uint32_t ms) { connectStallMs = ms; }
+
+// DNS and the TCP handshake, false once the connect timeout ran out.
+static bool tcpConnect(uint32_t timeoutMs) {
+  uint32_t connectMs = timing::DNS_LOOKUP + timing::TCP_CONNECT + connectStallMs;
+  advanceMs(std::min(connectMs, timeoutMs));
+  return connectMs <= timeoutMs;
+}
+
+static uint32_t forecasts = 0;
+uint32_t forecastResponses() { return forecasts; }
+
+// The socket last opened by WiFiClient::connect(), and its host.
+static WiFiClient* openSocket = nullptr;
+static std::string openSocketHost;
+
+HttpResponse httpRequest(const char* method, const String& url, const String& payload, uint32_t timeoutMs, uint32_t connectTimeoutMs, bool socketOpen) {
+  (void)method;
+  bool tls = url.startsWith("https://");
+  int hostStart = url.indexOf("://") + 3;
+  int pathStart = url.indexOf('/', hostStart);
+  String host = url.substring(hostStart, pathStart < 0 ? url.length() : pathStart);
+  String path = pathStart < 0 ? String("/") : url.substring(pathStart);
+
+  Activity activity(label("http:" + std::string(host.c_str())));
+  if (WiFi.status() != WL_CONNECTED) return HttpResponse{HTTPC_ERROR_CONNECTION_REFUSED, String()};
+  WiFiClient* socket = nullptr;
+  if (socketOpen) {
+    if (!openSocket || openSocketHost != host.c_str()) return HttpResponse{HTTPC_ERROR_NOT_CONNECTED, String()};
+    socket = openSocket;
+  } else {
+    if (!tcpConnect(connectTimeoutMs)) return HttpResponse{HTTPC_ERROR_CONNECTION_REFUSED, String()};
+    if (tls) advanceMs(timing::TLS_HANDSHAKE);
+  }
+  advanceMs(1 + payload.length() / timing::HTTP_BYTES_PER_MS);
+
+  HttpResponse response{404, String()};
+  uint32_t readings = 0;
+  bool forecast = false;
+  if (host == "api.open-meteo.com" && path.startsWith("/v1/forecast")) {
+    forecast = true;
+    ForecastModel model = forecastModel(url);
+    response = HttpResponse{200, url.indexOf("format=flatbuffers") >= 0 ? forecastFlatBuffer(model) : forecastJson(model)};
+  }
+  else if (host == "api.thingspeak.com" && path.endsWith("/bulk_update.json")) {
+    response = HttpResponse{202, String("{\"success\":true}")};
+    for (int at = payload.indexOf("delta_t"); at >= 0; at = payload.indexOf("delta_t", at + 1)) readings++;
+  }
+  else if (host == "api.thingspeak.com" && path.startsWith("/update")) response = HttpResponse{200, String("1")};
+
+  uint32_t responseMs = timing::HTTP_SERVER + serverStallMs + response.body.length() / timing::HTTP_BYTES_PER_MS;
+  if (responseMs > timeoutMs) {
+    advanceMs(timeoutMs);
+    return HttpResponse{HTTPC_ERROR_READ_TIMEOUT, String()};
+  }
+  advanceMs(responseMs);
+  time_t utc = wallClock() - ForecastModel::UTC_OFFSET;
+  struct tm tm;
+  char date[32];
+  gmtime_r(&utc, &tm);
+  strftime(date, sizeof(date), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+  response.date = date;
+  thingSpeakReadings += readings;
+  if (forecast) forecasts++;
+  if (socket) socket->receive(response.body);
+  return response;
+}
+
+}
+
+WiFiClient::~WiFiClient() { stop(); }
+
+int WiFiClient::connect(const char* host, uint16_t port, int32_t timeout) {
+  (void)port;
+  stop();
+  sim::Activity activity(sim::label("http:" + std::string(host)));
+  if (WiFi.status() != WL_CONNECTED) return 0;
+  if (!sim::tcpConnect(timeout > 0 ? timeout : 3000)) return 0;
+  sim::openSocket = this;
+  sim::openSocketHost = host;
+  return 1;
+}
+
+void WiFiClient::stop() {
+  if (sim::openSocket == this) sim::openSocket = nullptr;
+}
+
+// ################################# TLS #######################################
+
+namespace sim {
+
+// Ticket as the stand-in server issues it: key, issue time and host.
+struct TlsTicket {
+  uint32_t key;
+  uint32_t issuedS;
+  uint32_t hostHash;
+};
+
+static uint32_t hashHost(const char* host) {
+  uint32_t hash = 2166136261u;
+  while (*host) hash = (hash ^ static_cast<uint8_t>(*host++)) * 16777619u;
+  return hash;
+}
+
+TlsServer& tlsServer(const char* host) {
+  static std::map<std::string, TlsServer> servers;
+  return servers[host];
+}
+
+int tlsHandshake(const char* host, const uint8_t* ticket, size_t ticketLength, uint8_t* newTicket, size_t* newTicketLength) {
+  Activity activity(label("tls:" + std::string(host)));
+  TlsServer& server = tlsServer(host);
+  uint32_t now = static_cast<uint32_t>(wallClock());
+  if (ticketLength > 0 && server.abortOnTicket) {
+    advanceMs(timing::TLS_RESUME);
+    return MBEDTLS_ERR_SSL_FATAL_ALERT_MESSAGE;
+  }
+
+  TlsTicket offered = {};
+  if (ticketLength == sizeof(offered)) memcpy(&offered, ticket, sizeof(offered));
+  bool resumed = ticketLength == sizeof(offered)
+    && offered.key == server.ticketKey
+    && offered.hostHash == hashHost(host)
+    && now - offered.issuedS < server.ticketLifetimeS;
+  advanceMs(resumed ? timing::TLS_RESUME : timing::TLS_HANDSHAKE);
+  (resumed ? server.resumedHandshakes : server.fullHandshakes)++;
+
+  TlsTicket issued = {server.ticketKey, resumed ? offered.issuedS : now, hashHost(host)};
+  memcpy(newTicket, &issued, sizeof(issued));
+  *newTicketLength = sizeof(issued);
+  return 0;
+}
+
+}
+
+// Session blobs carry a header, as mbedTLS checks its version and config.
+static const char SESSION_MAGIC[4] = {'S', 'I', 'M', '1'};
+
+void mbedtls_ssl_init(mbedtls_ssl_context* ssl) { memset(ssl, 0, sizeof(*ssl)); }
+void mbedtls_ssl_free(mbedtls_ssl_context* ssl) { memset(ssl, 0, sizeof(*ssl)); }
+void mbedtls_ssl_config_init(mbedtls_ssl_config* conf) { memset(conf, 0, sizeof(*conf)); }
+void mbedtls_ssl_config_free(mbedtls_ssl_config* conf) { memset(conf, 0, sizeof(*conf)); }
+
+int mbedtls_ssl_config_defaults(mbedtls_ssl_config* conf, int endpoint, int transport, int preset) {
+  (void)transport; (void)preset;
+  conf->endpoint = endpoint;
+  conf->authmode = MBEDTLS_SSL_VERIFY_REQUIRED;
+  conf->session_tickets = MBEDTLS_SSL_SESSION_TICKETS_ENABLED;
+  return 0;
+}
+
+void mbedtls_ssl_conf_authmode(mbedtls_ssl_config* conf, int authmode) { conf->authmode = authmode; }
+
+void mbedtls_ssl_conf_rng(mbedtls_ssl_config* conf, int (*f_rng)(void*, unsigned char*, size_t), void* p_rng) {
+  conf->f_rng = f_rng;
+  conf->p_rng = p_rng;
+}
+
+void mbedtls_ssl_conf_session_tickets(mbedtls_ssl_config* conf, int use_tickets) { conf->session_tickets = use_tickets; }
+
+int mbedtls_ssl_setup(mbedtls_ssl_context* ssl, const mbedtls_ssl_config* conf) {
+  if (!conf->f_rng) return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+  ssl->conf = conf;
+  return 0;
+}
+
+int mbedtls_ssl_set_hostname(mbedtls_ssl_context* ssl, const char* hostname) {
+  if (strlen(hostname) >= sizeof(ssl->hostname)) return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+  strcpy(ssl->hostname, hostname);
+  return 0;
+}
+
+void mbedtls_ssl_set_bio(mbedtls_ssl_context* ssl, void* p_bio, mbedtls_ssl_send_t* f_send, mbedtls_ssl_recv_t* f_recv, mbedtls_ssl_recv_timeout_t* f_recv_timeout) {
+  (void)f_recv_timeout;
+  ssl->p_bio = p_bio;
+  ssl->f_send = f_send;
+  ssl->f_recv = f_recv;
+}
+
+void mbedtls_ssl_session_init(mbedtls_ssl_session* session) { memset(session, 0, sizeof(*session)); }
+void mbedtls_ssl_session_free(mbedtls_ssl_session* session) { memset(session, 0, sizeof(*session)); }
+
+int mbedtls_ssl_set_session(mbedtls_ssl_context* ssl, const mbedtls_ssl_session* session) {
+  if (!ssl->conf || ssl->handshake_over) return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+  ssl->session = *session;
+  return 0;
+}
+
+int mbedtls_ssl_get_session(const mbedtls_ssl_context* ssl, mbedtls_ssl_session* session) {
+  if (!ssl->handshake_over) return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+  *session = ssl->session;
+  return 0;
+}
+
+int mbedtls_ssl_session_save(const mbedtls_ssl_session* session, unsigned char* buf, size_t buf_len, size_t* olen) {
+  *olen = sizeof(SESSION_MAGIC) + 1 + session->ticket_len;
+  if (buf_len < *olen) return MBEDTLS_ERR_SSL_BUFFER_TOO_SMALL;
+  memcpy(buf, SESSION_MAGIC, sizeof(SESSION_MAGIC));
+  buf[sizeof(SESSION_MAGIC)] = static_cast<unsigned char>(session->ticket_len);
+  memcpy(buf + sizeof(SESSION_MAGIC) + 1, session->ticket, session->ticket_len);
+  return 0;
+}
+
+int mbedtls_ssl_session_load(mbedtls_ssl_session* session, const unsigned char* buf, size_t len) {
+  if (len < sizeof(SESSION_MAGIC) + 1 || memcmp(buf, SESSION_MAGIC, sizeof(SESSION_MAGIC)) != 0) return MBEDTLS_ERR_SSL_VERSION_MISMATCH;
+  size_t ticketLength = buf[sizeof(SESSION_MAGIC)];
+  if (ticketLength > sizeof(session->ticket) || len != sizeof(SESSION_MAGIC) + 1 + ticketLength) return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+  session->ticket_len = ticketLength;
+  memcpy(session->ticket, buf + sizeof(SESSION_MAGIC) + 1, ticketLength);
+  return 0;
+}
+
+int mbedtls_ssl_handshake(mbedtls_ssl_context* ssl) {
+  if (!ssl->conf || !ssl->f_send || !ssl->f_recv) return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+  if (ssl->handshake_over) return 0;
+  // A slow server's first flight is waited for through the client's receive callback.
+  uint32_t flightDelayMs = sim::tlsServer(ssl->hostname).flightDelayMs;
+  if (flightDelayMs > 0 && sim::openSocket) {
+    sim::openSocket->receiveAt(sim::nowUs() + uint64_t(flightDelayMs) * 1000, String("\x16"));
+    unsigned char record[16];
+    int received;
+    while ((received = ssl->f_recv(ssl->p_bio, record, sizeof(record))) == MBEDTLS_ERR_SSL_WANT_READ) {}
+    sim::openSocket->receive(String());
+    if (received < 0) return received;
+  }
+  bool tickets = ssl->conf->session_tickets == MBEDTLS_SSL_SESSION_TICKETS_ENABLED;
+  mbedtls_ssl_session issued = {};
+  int ret = sim::tlsHandshake(ssl->hostname, ssl->session.ticket, tickets ? ssl->session.ticket_len : 0, issued.ticket, &issued.ticket_len);
+  if (ret != 0) return ret;
+  if (!tickets) issued.ticket_len = 0;
+  ssl->session = issued;
+  ssl->handshake_over = true;
+  return 0;
+}
+
+int mbedtls_ssl_read(mbedtls_ssl_context* ssl, unsigned char* buf, size_t len) {
+  if (!ssl->handshake_over) return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+  return ssl->f_recv(ssl->p_bio, buf, len);
+}
+
+int mbedtls_ssl_write(mbedtls_ssl_context* ssl, const unsigned char* buf, size_t len) {
+  if (!ssl->handshake_over) return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+  return ssl->f_send(ssl->p_bio, buf, len);
+}
+
+// Records are passed through, nothing is ever decrypted ahead.
+size_t mbedtls_ssl_get_bytes_avail(const mbedtls_ssl_context* ssl) { (void)ssl; return 0; }
+
+int mbedtls_ssl_close_notify(mbedtls_ssl_context* ssl) { return ssl->handshake_over ? 0 : MBEDTLS_ERR_SSL_BAD_INPUT_DATA; }
+
+void mbedtls_entropy_init(mbedtls_entropy_context* ctx) { ctx->counter = 0; }
+void mbedtls_entropy_free(mbedtls_entropy_context* ctx) { ctx->counter = 0; }
+
+int mbedtls_entropy_func(void* data, unsigned char* output, size_t len) {
+  mbedtls_entropy_context* ctx = static_cast<mbedtls_entropy_context*>(data);
+  for (size_t i = 0; i < len; i++) output[i] = static_cast<unsigned char>(ctx->counter++ * 167u);
+  return 0;
+}
+
+void mbedtls_ctr_drbg_init(mbedtls_ctr_drbg_context* ctx) { ctx->state = 0; }
+void mbedtls_ctr_drbg_free(mbedtls_ctr_drbg_context* ctx) { ctx->state = 0; }
+
+int mbedtls_ctr_drbg_seed(mbedtls_ctr_drbg_context* ctx, int (*f_entropy)(void*, unsigned char*, size_t), void* p_entropy, const unsigned char* custom, size_t len) {
+  (void)custom; (void)len;
+  return f_entropy(p_entropy, reinterpret_cast<unsigned char*>(&ctx->state), sizeof(ctx->state));
+}
+
+int mbedtls_ctr_drbg_random(void* p_rng, unsigned char* output, size_t output_len) {
+  mbedtls_ctr_drbg_context* ctx = static_cast<mbedtls_ctr_drbg_context*>(p_rng);
+  for (size_t i = 0; i < output_len; i++) {
+    ctx->state = ctx->state * 1664525u + 1013904223u;
+    output[i] = static_cast<unsigned char>(ctx->state >> 24);
+  }
+  return 0;
+}
+
+// ############################### Display #####################################
+
+namespace sim {
+
+Panel panel = {};
+static int16_t epdBusyPin = -1;
+static uint64_t epdBusyUntilUs = 0;
+
+void epdAttachBusyPin(int16_t pin) { epdBusyPin = pin; }
+
+void epdPower(bool on) {
+  panel.powered = on;
+  setCurrent(COMPONENT_EPD, on ? current::EPD_IDLE : 0.0f);
+}
+
+uint64_t epdRefreshBegin(const uint8_t* buffer, uint16_t x, uint16_t y, uint16_t w, uint16_t h, bool partial) {
+  advanceUs(uint64_t(w) * h / 8 * 2 / 5);  // SPI @ 20 MHz, writeImage + writeImageAgain
+  for (uint16_t row = 0; row < h; row++) {
+    memcpy(&panel.pixels[(y + row) * (Panel::WIDTH / 8) + x / 8], &buffer[row * (w / 8)], w / 8);
+  }
+  if (partial) panel.partialRefreshes++;
+  else panel.fullRefreshes++;
+  setCurrent(COMPONENT_EPD, current::EPD_REFRESH);
+  epdBusyUntilUs = nowUs() + uint64_t(partial ? timing::EPD_PARTIAL_REFRESH : timing::EPD_FULL_REFRESH) * 1000;
+  return epdBusyUntilUs;
+}
+
+void epdRefreshEnd() { setCurrent(COMPONENT_EPD, panel.powered ? current::EPD_IDLE : 0.0f); }
+
+bool epdBusy() { return nowUs() < epdBusyUntilUs; }
+
+bool writePanelPbm(const char* path) {
+  FILE* f = fopen(path, "wb");
+  if (!f) return false;
+  // The firmware draws with rotation 2, so flip back to what a viewer sees.
+  fprintf(f, "P4\n%u %u\n", Panel::WIDTH, Panel::HEIGHT);
+  for (int row = Panel::HEIGHT - 1; row >= 0; row--) {
+    uint8_t line[Panel::WIDTH / 8];
+    for (int i = 0; i < Panel::WIDTH / 8; i++) {
+      uint8_t b = panel.pixels[row * (Panel::WIDTH / 8) + (Panel::WIDTH / 8 - 1 - i)];
+      uint8_t r = 0;
+      for (int bit = 0; bit < 8; bit++) r |= ((b >> bit) & 1) << (7 - bit);
+      line[i] = static_cast<uint8_t>(~r);  // PBM: 1 = black
+    }
+    fwrite(line, 1, sizeof(line), f);
+  }
+  fclose(f);
+  return true;
+}
+
+}
+
+int digitalRead(uint8_t pin) {
+  if (pin == sim::epdBusyPin) return sim::epdBusy() ? HIGH : LOW;
+  return pin < 32 ? sim::pinLevels[pin] : LOW;
+}
+
+namespace sim {
+// Time from now until an input reads `level`, FOREVER if nothing changes it.
+static uint64_t untilPinLevelUs(uint8_t pin, uint8_t level) {
+  if (digitalRead(pin) == level) return 0;
+  if (pin == epdBusyPin && level == LOW) return epdBusyUntilUs - nowUs();
+  return FOREVER;
+}
+}
@@ -0,0 +1,298 @@
+#include "sim.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace sim {
+
+namespace {
+
+const char* COMPONENT_NAMES[COMPONENT_COUNT] = {"cpu", "radio", "scd40", "aht20+bmp280", "epd"};
+
+struct Bucket {
+  std::string label;
+  uint64_t us;
+  double charge;  // mA * us
+};
+
+struct Wake {
+  uint64_t awakeUs;
+  uint64_t sleepUs;
+  uint64_t radioUs;
+  double awakeCharge;
+  double sleepCharge;
+  double hostUs;
+  double componentCharge[COMPONENT_COUNT];
+  std::vector<Bucket> phases;
+};
+
+uint64_t simNowUs = 0;
+uint64_t wakeStartUs = 0;
+bool awake = false;
+float currents[COMPONENT_COUNT] = {};
+
+uint32_t wakes = 0;
+Wake currentWake;
+std::vector<Wake> history;
+std::chrono::steady_clock::time_point hostStart;
+
+Bucket& phaseBucket(const char* label) {
+  for (Bucket& b : currentWake.phases) {
+    if (b.label == label) return b;
+  }
+  currentWake.phases.push_back(Bucket{label, 0, 0});
+  return currentWake.phases.back();
+}
+
+double totalCurrent() {
+  double sum = current::BOARD_QUIESCENT;
+  for (float c : currents) sum += c;
+  return sum;
+}
+
+}
+
+// ############################### Tasks #######################################
+
+struct Task {
+  std::string name;
+  const char* activity;
+  uint64_t wakeAtUs;
+  uint64_t order;
+  const void* waitObject;
+  bool killed;
+  std::condition_variable turn;
+};
+
+struct TaskKilled {};
+
+namespace {
+
+std::mutex schedulerMutex;
+Task mainTask{"main", "cpu", 0, 0, nullptr, false, {}};
+std::vector<Task*> tasks{&mainTask};
+Task* running = &mainTask;
+thread_local Task* self = &mainTask;
+uint64_t blockOrder = 0;
+
+// Concurrent activities share the interval, e.g. "epd refresh + http:host".
+const char* intervalLabel() {
+  static std::set<std::string> labels;
+  std::string label;
+  for (Task* t : tasks) {
+    if (std::string(t->activity) == "cpu") continue;
+    if (!label.empty()) label += " + ";
+    label += t->activity;
+  }
+  if (label.empty()) return "cpu";
+  return labels.insert(label).first->c_str();
+}
+
+void tick(uint64_t us) {
+  if (us == 0) return;
+  double total = totalCurrent();
+  if (awake) {
+    currentWake.awakeUs += us;
+    currentWake.awakeCharge += total * us;
+    if (currents[COMPONENT_RADIO] > 0) currentWake.radioUs += us;
+    for (int c = 0; c < COMPONENT_COUNT; c++) currentWake.componentCharge[c] += double(currents[c]) * us;
+    Bucket& b = phaseBucket(intervalLabel());
+    b.us += us;
+    b.charge += total * us;
+  } else {
+    currentWake.sleepUs += us;
+    currentWake.sleepCharge += total * us;
+  }
+  simNowUs += us;
+}
+
+// Hands control to the task due first, advancing the clock if all wait.
+// Called with the scheduler lock held; returns the task now running.
+Task* handOver() {
+  Task* next = nullptr;
+  for (Task* t : tasks) {
+    if (!next || t->wakeAtUs < next->wakeAtUs || (t->wakeAtUs == next->wakeAtUs && t->order < next->order)) next = t;
+  }
+  if (next->wakeAtUs == FOREVER) {
+    fprintf(stderr, "sim: every task is waiting forever\n");
+    abort();
+  }
+  if (next->wakeAtUs > simNowUs) tick(next->wakeAtUs - simNowUs);
+  next->wakeAtUs = FOREVER;
+  running = next;
+  next->turn.notify_one();
+  return next;
+}
+
+void block(uint64_t wakeAtUs, const void* waitObject) {
+  std::unique_lock<std::mutex> lock(schedulerMutex);
+  Task* me = self;
+  me->wakeAtUs = wakeAtUs;
+  me->waitObject = waitObject;
+  me->order = ++blockOrder;
+  if (handOver() != me) me->turn.wait(lock, [me] { return running == me; });
+  me->waitObject = nullptr;
+  if (me->killed) throw TaskKilled();
+}
+
+void removeSelf() {
+  Task* me = self;
+  tasks.erase(std::find(tasks.begin(), tasks.end(), me));
+  if (me->killed) {
+    // killTasks() is waiting for us on the main task.
+    running = &mainTask;
+    mainTask.turn.notify_one();
+  } else {
+    handOver();
+  }
+}
+
+}
+
+Task* spawnTask(void (*function)(void*), void* parameter, const char* name) {
+  Task* task = new Task{name, "cpu", simNowUs, ++blockOrder, nullptr, false, {}};
+  {
+    std::lock_guard<std::mutex> lock(schedulerMutex);
+    tasks.push_back(task);
+  }
+  std::thread([task, function, parameter] {
+    std::unique_lock<std::mutex> lock(schedulerMutex);
+    self = task;
+    task->turn.wait(lock, [task] { return running == task; });
+    if (!task->killed) {
+      lock.unlock();
+      try {
+        function(parameter);
+      } catch (const TaskKilled&) {
+      }
+      lock.lock();
+    }
+    removeSelf();
+    lock.unlock();
+    delete task;
+  }).detach();
+  return task;
+}
+
+void exitTask() { throw TaskKilled(); }
+
+void blockUntil(uint64_t wakeAtUs, const void* waitObject) { block(wakeAtUs, waitObject); }
+
+void notify(const void* waitObject) {
+  std::lock_guard<std::mutex> lock(schedulerMutex);
+  for (Task* t : tasks) {
+    if (t != self && t->waitObject == waitObject) t->wakeAtUs = std::min(t->wakeAtUs, simNowUs);
+  }
+}
+
+void killTasks() {
+  std::unique_lock<std::mutex> lock(schedulerMutex);
+  while (tasks.size() > 1) {
+    Task* victim = tasks.back();
+    victim->killed = true;
+    running = victim;
+    victim->turn.notify_one();
+    mainTask.turn.wait(lock, [] { return running == &mainTask; });
+  }
+}
+
+uint64_t nowUs() { return simNowUs; }
+uint64_t bootUs() { return simNowUs - wakeStartUs; }
+
+void advanceUs(uint64_t us) {
+  if (tasks.size() == 1) tick(us);
+  else block(simNowUs + us, nullptr);
+}
+
+void haltUs(uint64_t us) { tick(us); }
+
+void setCurrent(Component component, float mA) { currents[component] = mA; }
+float getCurrent(Component component) { return currents[component]; }
+
+Activity::Activity(const char* label) : _previous(self->activity) { self->activity = label; }
+Activity::~Activity() { self->activity = _previous; }
+
+void beginWake() {
+  wakes++;
+  currentWake = Wake();
+  wakeStartUs = simNowUs;
+  awake = true;
+  mainTask.activity = "cpu";
+  currents[COMPONENT_CPU] = current::CPU_ACTIVE;
+  currents[COMPONENT_RADIO] = 0;
+  hostStart = std::chrono::steady_clock::now();
+}
+
+void endWake(uint64_t sleepUs) {
+  killTasks();
+  currentWake.hostUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - hostStart).count();
+  awake = false;
+  float cpu = currents[COMPONENT_CPU];
+  float radio = currents[COMPONENT_RADIO];
+  currents[COMPONENT_CPU] = current::CPU_DEEP_SLEEP;
+  currents[COMPONENT_RADIO] = 0;
+  tick(sleepUs);
+  currents[COMPONENT_CPU] = cpu;
+  currents[COMPONENT_RADIO] = radio;
+  history.push_back(currentWake);
+}
+
+uint32_t wakeCount() { return wakes; }
+uint64_t lastWakeAwakeUs() { return history.empty() ? 0 : history.back().awakeUs; }
+uint64_t lastWakeRadioUs() { return history.empty() ? 0 : history.back().radioUs; }
+
+// mA * us -> mC
+static double toMilliCoulomb(double charge) { return charge / 1e6; }
+// mA * us -> mJ at the battery
+static double toMilliJoule(double charge) { return charge / 1e6 * BATTERY_VOLTAGE; }
+
+double lastWakeChargeMc() { return history.empty() ? 0 : toMilliCoulomb(history.back().awakeCharge); }
+
+void printWakeReport() {
+  const Wake& w = history.back();
+  printf("\n=== wake %u: awake %.1f ms (host %.1f ms), %.2f mC / %.2f mJ, then sleep %.1f s ===\n",
+         wakes, w.awakeUs / 1000.0, w.hostUs / 1000.0,
+         toMilliCoulomb(w.awakeCharge), toMilliJoule(w.awakeCharge), w.sleepUs / 1e6);
+  printf("  %-28s %10s %10s %10s\n", "phase", "ms", "mC", "mJ");
+  for (const Bucket& b : w.phases) {
+    printf("  %-28s %10.1f %10.3f %10.3f\n", b.label.c_str(), b.us / 1000.0, toMilliCoulomb(b.charge), toMilliJoule(b.charge));
+  }
+  printf("  %-28s %10s %10s\n", "component", "", "mC");
+  for (int c = 0; c < COMPONENT_COUNT; c++) {
+    printf("  %-28s %10s %10.3f\n", COMPONENT_NAMES[c], "", toMilliCoulomb(w.componentCharge[c]));
+  }
+}
+
+void printSummary() {
+  // The first boot waits 10 s for an upload window, leave it out of the averages.
+  size_t first = history.size() > 1 ? 1 : 0;
+  size_t n = history.size() - first;
+  if (n == 0) return;
+
+  double awakeUs = 0, sleepUs = 0, awakeCharge = 0, sleepCharge = 0, hostUs = 0;
+  uint64_t worstAwakeUs = 0;
+  for (size_t i = first; i < history.size(); i++) {
+    awakeUs += history[i].awakeUs;
+    sleepUs += history[i].sleepUs;
+    awakeCharge += history[i].awakeCharge;
+    sleepCharge += history[i].sleepCharge;
+    hostUs += history[i].hostUs;
+    worstAwakeUs = std::max(worstAwakeUs, history[i].awakeUs);
+  }
+  double averageCurrent = (awakeCharge + sleepCharge) / (awakeUs + sleepUs);
+
+  printf("\n=== summary over %zu wakes (cold boot excluded) ===\n", n);
+  printf("  awake per wake      %10.1f ms (worst %.1f ms)\n", awakeUs / n / 1000.0, worstAwakeUs / 1000.0);
+  printf("  host time per wake  %10.1f ms\n", hostUs / n / 1000.0);
+  printf("  charge per wake     %10.2f mC awake + %.2f mC asleep\n", toMilliCoulomb(awakeCharge) / n, toMilliCoulomb(sleepCharge) / n);
+  printf("  energy per wake     %10.2f mJ\n", toMilliJoule(awakeCharge + sleepCharge) / n);
+  printf("  average current     %10.3f mA (%.1f mAh/day)\n", averageCurrent, averageCurrent * 24.0);
+}
+
+}
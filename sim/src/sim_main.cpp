@@ -0,0 +1,34 @@
+#include <Arduino.h>
+#include <GxEPD2_BW.h>
+#include <cstdio>
+#include <cstdlib>
+#include <sim_test.h>
+#include "../../src/profiler.h"
+
+// Runs consecutive wake cycles of the firmware against the hardware models.
+//   program [wakes] [pbm-prefix]
+int main(int argc, char** argv) {
+  int wakes = argc > 1 ? atoi(argv[1]) : 14;
+  const char* pbmPrefix = argc > 2 ? argv[2] : nullptr;
+
+  setenv("TZ", "UTC0", 1);
+  tzset();
+
+  for (int i = 0; i < wakes; i++) {
+    sim::runWake();
+    sim::printWakeReport();
+    printf("  profiler:");
+    for (int p = 0; p < PHASE_COUNT; p++) {
+      printf(" %s=%u", profilerPhaseName(static_cast<ProfilePhase>(p)), profilerLast(static_cast<ProfilePhase>(p)));
+    }
+    printf("\n  rollup (min/avg/max over %u): %s\n", profilerCycles(), profilerSummary().c_str());
+
+    if (pbmPrefix) {
+      char path[256];
+      snprintf(path, sizeof(path), "%s%02d.pbm", pbmPrefix, i + 1);
+      sim::writePanelPbm(path);
+    }
+  }
+  sim::printSummary();
+  return 0;
+}
@@ -0,0 +1,264 @@
+#include "forecast.h"
+
+DeserializationError parseForecast(Stream& input, Forecast& forecast) {
+  JsonDocument filter;
+  filter["hourly"]["time"] = true;
+  filter["hourly"]["temperature_2m"] = true;
+  filter["hourly"]["rain"] = true;
+  filter["hourly"]["snowfall"] = true;
+  filter["daily"]["sunrise"] = true;
+  filter["daily"]["sunset"] = true;
+
+  JsonDocument doc;
+  DeserializationError error = deserializeJson(doc, input, DeserializationOption::Filter(filter));
+  if (error) return error;
+  if (!readForecast(doc, forecast)) return DeserializationError::InvalidInput;
+  return DeserializationError::Ok;
+}
+
+bool readForecast(JsonDocument& doc, Forecast& forecast) {
+  JsonArray tempArray = doc["hourly"]["temperature_2m"];
+  JsonArray rainArray = doc["hourly"]["rain"];
+  JsonArray snowArray = doc["hourly"]["snowfall"];
+  const char* firstTime = doc["hourly"]["time"][0];
+  
+  if (firstTime == NULL || strlen(firstTime) < 13) return false;
+
+  Forecast parsed = forecast;
+  String first = firstTime;
+  parsed.startHour = first.substring(11, 13).toInt();
+  
+  struct tm timeinfo = {0};
+  timeinfo.tm_year = first.substring(0, 4).toInt() - 1900;
+  timeinfo.tm_mon = first.substring(5, 7).toInt() - 1;
+  timeinfo.tm_mday = first.substring(8, 10).toInt();
+  timeinfo.tm_hour = parsed.startHour;
+  parsed.startTimestamp = mktime(&timeinfo);
+  
+  // icon_d2 ends 48 h after its model run, so the last hours can be null.
+  // The cache ends at the first one; missing rain or snow reads as none.
+  parsed.hours = 0;
+  for (size_t i = 0; i < min<size_t>(FORECAST_CACHE_HOURS, tempArray.size()) && !tempArray[i].isNull(); i++) {
+    parsed.hours = i + 1;
+    parsed.temp[i] = tempArray[i];
+    // Combine rain and snowfall (snowfall in cm, convert to mm equivalent)
+    float rain = rainArray[i] | 0.0f;
+    float snow = snowArray[i] | 0.0f;
+    parsed.rain[i] = rain + (snow * 10.0f);  // 1cm snow ≈ 10mm water
+  }
+  if (parsed.hours == 0) return false;
+  
+  // Extract HH:MM
+  for (int day = 0; day < FORECAST_DAYS; day++) {
+    const char* sunrise = doc["daily"]["sunrise"][day];
+    if (sunrise && strlen(sunrise) >= 16) snprintf(parsed.sunrise[day], sizeof(parsed.sunrise[day]), "%.5s", sunrise + 11);
+    const char* sunset = doc["daily"]["sunset"][day];
+    if (sunset && strlen(sunset) >= 16) snprintf(parsed.sunset[day], sizeof(parsed.sunset[day]), "%.5s", sunset + 11);
+  }
+
+  forecast = parsed;
+  return true;
+}
+
+// ############################### FlatBuffers ###################################
+
+// Field indices in the openmeteo_sdk weather_api.fbs tables.
+enum : uint8_t { RESPONSE_UTC_OFFSET_SECONDS = 6, RESPONSE_DAILY = 10, RESPONSE_HOURLY = 11 };
+enum : uint8_t { VARIABLES_TIME = 0, VARIABLES_VARIABLES = 3 };
+enum : uint8_t { VARIABLE_VALUES = 3, VARIABLE_VALUES_INT64 = 4 };
+
+// Bounds-checked view of a FlatBuffers table, read in place. Reads go
+// through memcpy since the response buffer gives no alignment guarantees.
+class FlatTable {
+  public:
+    FlatTable() : _buf(NULL), _size(0), _pos(0) {}
+    FlatTable(const uint8_t* buf, size_t size, size_t pos) : _buf(buf), _size(size), _pos(pos) {
+      int32_t vtable;
+      if (!read(_pos, vtable) || !read(_pos - vtable, _vtableSize) || _vtableSize < 4) _buf = NULL;
+    }
+
+    bool valid() const { return _buf != NULL; }
+
+    template <typename T> T scalar(uint8_t field, T fallback) const {
+      T value;
+      size_t at = fieldPos(field);
+      return at && read(at, value) ? value : fallback;
+    }
+
+    FlatTable table(uint8_t field) const {
+      size_t target = reference(fieldPos(field));
+      return target ? FlatTable(_buf, _size, target) : FlatTable();
+    }
+
+    // Element `index` of a vector of tables.
+    FlatTable tableAt(uint8_t field, uint32_t index) const {
+      size_t start = vector(field, 4);
+      if (!start || index >= length(start)) return FlatTable();
+      size_t target = reference(start + 4 + 4 * index);
+      return target ? FlatTable(_buf, _size, target) : FlatTable();
+    }
+
+    // Start of a scalar vector (its length word), 0 if absent or truncated.
+    size_t vector(uint8_t field, size_t elementSize) const {
+      size_t start = reference(fieldPos(field));
+      if (!start) return 0;
+      uint32_t count = length(start);
+      return start + 4 + uint64_t(count) * elementSize <= _size ? start : 0;
+    }
+
+    uint32_t length(size_t vectorStart) const {
+      uint32_t count = 0;
+      read(vectorStart, count);
+      return count;
+    }
+
+    template <typename T> T element(size_t vectorStart, uint32_t index) const {
+      T value = 0;
+      read(vectorStart + 4 + index * sizeof(T), value);
+      return value;
+    }
+
+  private:
+    const uint8_t* _buf;
+    size_t _size;
+    size_t _pos;
+    uint16_t _vtableSize = 0;
+
+    template <typename T> bool read(size_t at, T& value) const {
+      if (_buf == NULL || at > _size || _size - at < sizeof(T)) return false;
+      memcpy(&value, _buf + at, sizeof(T));
+      return true;
+    }
+
+    size_t fieldPos(uint8_t field) const {
+      if (_buf == NULL || 4 + 2 * field + 2 > _vtableSize) return 0;
+      int32_t vtable;
+      uint16_t offset;
+      if (!read(_pos, vtable) || !read(_pos - vtable + 4 + 2 * field, offset)) return 0;
+      return offset ? _pos + offset : 0;
+    }
+
+    size_t reference(size_t at) const {
+      uint32_t offset;
+      if (!at || !read(at, offset) || offset == 0 || at + offset >= _size) return 0;
+      return at + offset;
+    }
+};
+
+// Value `index` of a values_int64 variable (a unix time) as local "HH:MM".
+static void readClock(const FlatTable& variable, uint32_t index, int32_t utcOffset, char* out, size_t size) {
+  size_t values = variable.vector(VARIABLE_VALUES_INT64, sizeof(int64_t));
+  if (!values || index >= variable.length(values)) return;
+  int64_t localTime = variable.element<int64_t>(values, index) + utcOffset;
+  int secondsOfDay = ((localTime % 86400) + 86400) % 86400;
+  snprintf(out, size, "%02d:%02d", secondsOfDay / 3600, secondsOfDay % 3600 / 60);
+}
+
+bool parseForecastFlatBuffer(const uint8_t* data, size_t size, Forecast& forecast) {
+  // Size-prefixed message: uint32 length, then the root table offset.
+  uint32_t messageSize, rootOffset;
+  if (size < 8) return false;
+  memcpy(&messageSize, data, 4);
+  if (messageSize > size - 4) return false;
+  data += 4;
+  size = messageSize;
+  memcpy(&rootOffset, data, 4);
+
+  FlatTable response(data, size, rootOffset);
+  FlatTable hourly = response.table(RESPONSE_HOURLY);
+  if (!hourly.valid()) return false;
+  int32_t utcOffset = response.scalar<int32_t>(RESPONSE_UTC_OFFSET_SECONDS, 0);
+
+  // Variables come in request order: temperature_2m, rain, snowfall.
+  FlatTable temp = hourly.tableAt(VARIABLES_VARIABLES, 0);
+  FlatTable rain = hourly.tableAt(VARIABLES_VARIABLES, 1);
+  FlatTable snow = hourly.tableAt(VARIABLES_VARIABLES, 2);
+  size_t tempValues = temp.vector(VARIABLE_VALUES, sizeof(float));
+  size_t rainValues = rain.vector(VARIABLE_VALUES, sizeof(float));
+  size_t snowValues = snow.vector(VARIABLE_VALUES, sizeof(float));
+  if (!tempValues) return false;
+
+  Forecast parsed = forecast;
+  int64_t start = hourly.scalar<int64_t>(VARIABLES_TIME, 0) + utcOffset;
+  parsed.startTimestamp = start;
+  parsed.startHour = ((start % 86400) + 86400) % 86400 / 3600;
+
+  // Hours past the end of the model run are NaN, see readForecast().
+  parsed.hours = 0;
+  for (uint32_t i = 0; i < min<uint32_t>(FORECAST_CACHE_HOURS, temp.length(tempValues)) && !isnan(temp.element<float>(tempValues, i)); i++) {
+    parsed.hours = i + 1;
+    parsed.temp[i] = temp.element<float>(tempValues, i);
+    float rainMm = rainValues && i < rain.length(rainValues) ? rain.element<float>(rainValues, i) : 0.0f;
+    float snowCm = snowValues && i < snow.length(snowValues) ? snow.element<float>(snowValues, i) : 0.0f;
+    if (isnan(rainMm)) rainMm = 0.0f;
+    if (isnan(snowCm)) snowCm = 0.0f;
+    parsed.rain[i] = rainMm + (snowCm * 10.0f);  // 1cm snow ≈ 10mm water
+  }
+  if (parsed.hours == 0) return false;
+
+  // daily=sunset,sunrise
+  FlatTable daily = response.table(RESPONSE_DAILY);
+  for (int day = 0; day < FORECAST_DAYS; day++) {
+    readClock(daily.tableAt(VARIABLES_VARIABLES, 0), day, utcOffset, parsed.sunset[day], sizeof(parsed.sunset[day]));
+    readClock(daily.tableAt(VARIABLES_VARIABLES, 1), day, utcOffset, parsed.sunrise[day], sizeof(parsed.sunrise[day]));
+  }
+
+  forecast = parsed;
+  return true;
+}
+
+// ################################# Packing #####################################
+
+static uint16_t packClock(const char* clock) {
+  if (!isdigit(clock[0]) || !isdigit(clock[1]) || clock[2] != ':' || !isdigit(clock[3]) || !isdigit(clock[4])) return NO_CLOCK;
+  return ((clock[0] - '0') * 10 + clock[1] - '0') * 60 + (clock[3] - '0') * 10 + clock[4] - '0';
+}
+
+static void unpackClock(uint16_t minutes, char* out, size_t size) {
+  if (minutes >= 24 * 60) snprintf(out, size, "--:--");
+  else snprintf(out, size, "%02d:%02d", minutes / 60, minutes % 60);
+}
+
+void packForecast(const Forecast& forecast, PackedForecast& packed) {
+  for (int i = 0; i < FORECAST_CACHE_HOURS; i++) {
+    packed.temp[i] = static_cast<int16_t>(constrain(lroundf(forecast.temp[i] * 10), -32768L, 32767L));
+    packed.rain[i] = static_cast<uint8_t>(constrain(lroundf(forecast.rain[i] * 10), 0L, 255L));
+  }
+  for (int day = 0; day < FORECAST_DAYS; day++) {
+    packed.sunrise[day] = packClock(forecast.sunrise[day]);
+    packed.sunset[day] = packClock(forecast.sunset[day]);
+  }
+  packed.startHour = forecast.startHour;
+  packed.startTimestamp = forecast.startTimestamp;
+  packed.hours = forecast.hours;
+}
+
+void unpackForecast(const PackedForecast& packed, Forecast& forecast) {
+  for (int i = 0; i < FORECAST_CACHE_HOURS; i++) {
+    forecast.temp[i] = packed.temp[i] / 10.0f;
+    forecast.rain[i] = packed.rain[i] / 10.0f;
+  }
+  for (int day = 0; day < FORECAST_DAYS; day++) {
+    unpackClock(packed.sunrise[day], forecast.sunrise[day], sizeof(forecast.sunrise[day]));
+    unpackClock(packed.sunset[day], forecast.sunset[day], sizeof(forecast.sunset[day]));
+  }
+  forecast.startHour = packed.startHour;
+  forecast.startTimestamp = packed.startTimestamp;
+  forecast.hours = min<uint8_t>(packed.hours, FORECAST_CACHE_HOURS);
+}
+
+// ################################# Window ######################################
+
+bool forecastWindow(const Forecast& forecast, uint32_t hoursSinceStart, ForecastWindow& window) {
+  bool valid = forecast.hours >= FORECAST_HOURS && hoursSinceStart <= uint32_t(forecast.hours - FORECAST_HOURS);
+  uint32_t offset = valid ? hoursSinceStart : 0;
+  uint32_t hour = forecast.startHour + offset;
+  uint32_t day = min<uint32_t>(hour / 24, FORECAST_DAYS - 1);
+  window.temp = forecast.temp + offset;
+  window.rain = forecast.rain + offset;
+  window.sunrise = forecast.sunrise[day];
+  window.sunset = forecast.sunset[day];
+  window.startHour = hour % 24;
+  window.startTimestamp = forecast.startTimestamp + offset * 3600;
+  return valid;
+}
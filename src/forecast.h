@@ -0,0 +1,68 @@
+#pragma once
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+/**
+ * Open-Meteo forecast parsing
+ *
+ * The default `format=flatbuffers` response is small enough to buffer and is
+ * read in place, without unpacking. JSON is the fallback: it is deserialized
+ * straight from the HTTP stream through a filter, so neither the raw payload
+ * nor the fields we don't draw are ever held in heap.
+**/
+
+const int FORECAST_HOURS = 24;        // drawn
+const int FORECAST_CACHE_HOURS = 48;  // fetched and kept, the window slides over it
+const int FORECAST_DAYS = 2;          // sunrise and sunset for every day a window starts on
+
+struct Forecast {
+  float temp[FORECAST_CACHE_HOURS];
+  float rain[FORECAST_CACHE_HOURS];  // rain + snowfall, in mm of water
+  char sunrise[FORECAST_DAYS][6];    // "HH:MM", from the day of the first hour on
+  char sunset[FORECAST_DAYS][6];
+  int startHour;
+  uint32_t startTimestamp;           // first hour, local time read as UTC
+  uint8_t hours;                     // received up to the first missing one, at most FORECAST_CACHE_HOURS
+};
+
+// Forecast as kept in RTC memory, 158 bytes instead of 420.
+struct __attribute__((packed)) PackedForecast {
+  int16_t temp[FORECAST_CACHE_HOURS];  // 0.1 °C
+  uint8_t rain[FORECAST_CACHE_HOURS];  // 0.1 mm, saturates at 25.5 mm
+  uint16_t sunrise[FORECAST_DAYS];     // minutes after midnight, NO_CLOCK if unknown
+  uint16_t sunset[FORECAST_DAYS];
+  uint8_t startHour;
+  uint32_t startTimestamp;
+  uint8_t hours;
+};
+
+const uint16_t NO_CLOCK = 0xFFFF;
+
+void packForecast(const Forecast& forecast, PackedForecast& packed);
+void unpackForecast(const PackedForecast& packed, Forecast& forecast);
+
+// The FORECAST_HOURS drawn from a cached forecast, pointing into it.
+struct ForecastWindow {
+  const float* temp;
+  const float* rain;
+  const char* sunrise;
+  const char* sunset;
+  int startHour;
+  uint32_t startTimestamp;
+};
+
+// Slides the window `hoursSinceStart` hours into the cache, counted from
+// the start of its first hour, so the graph keeps starting at the current
+// hour between fetches. False once fewer than FORECAST_HOURS are left; the
+// window then stays at the first hour.
+bool forecastWindow(const Forecast& forecast, uint32_t hoursSinceStart, ForecastWindow& window);
+
+// Parses a response read from `input`. `forecast` is only written on success.
+DeserializationError parseForecast(Stream& input, Forecast& forecast);
+
+// Takes the drawn fields from a deserialized response, false if it has none.
+bool readForecast(JsonDocument& doc, Forecast& forecast);
+
+// Parses a size-prefixed `format=flatbuffers` response (openmeteo_sdk
+// WeatherApiResponse) requested with the same variables, in the same order.
+bool parseForecastFlatBuffer(const uint8_t* data, size_t size, Forecast& forecast);
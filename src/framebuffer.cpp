@@ -0,0 +1,350 @@
+#include "framebuffer.h"
+#include <type_traits>
+
+// Explicit instantiations may name private members, which is the one
+// portable way to reach GxEPD2_BW's buffer without patching the library.
+// This relies on GxEPD2 1.5.9, pinned in platformio.ini: a member that is
+// renamed fails to compile, one that changes type fails the assert below.
+template <typename Tag, typename Actual, Actual Member>
+struct PrivateMember {
+	static_assert(std::is_same<Actual, typename Tag::type>::value, "GxEPD2_BW member changed type, check framebuffer.cpp against the new GxEPD2");
+	friend typename Tag::type member(Tag) { return Member; }
+};
+
+#define PRIVATE_MEMBER(TAG, TYPE, NAME) \
+	struct TAG { typedef TYPE DisplayType::*type; friend type member(TAG); }; \
+	template struct PrivateMember<TAG, decltype(&DisplayType::NAME), &DisplayType::NAME>
+
+// The buffer is addressed as one page of the whole panel, 8 px per byte.
+template <typename Display> struct SinglePage : std::false_type {};
+template <typename Panel, uint16_t page_height>
+struct SinglePage<GxEPD2_BW<Panel, page_height>> : std::integral_constant<bool, page_height == Panel::HEIGHT && Panel::WIDTH % 8 == 0> {};
+static_assert(SinglePage<DisplayType>::value, "frameBuffer() needs a single page buffer of the whole panel");
+
+typedef uint8_t PageBuffer[(GxEPD2_397_GDEM0397T81::WIDTH / 8) * GxEPD2_397_GDEM0397T81::HEIGHT];
+PRIVATE_MEMBER(BufferMember, PageBuffer, _buffer);
+PRIVATE_MEMBER(WindowXMember, uint16_t, _pw_x);
+PRIVATE_MEMBER(WindowYMember, uint16_t, _pw_y);
+PRIVATE_MEMBER(WindowWMember, uint16_t, _pw_w);
+PRIVATE_MEMBER(WindowHMember, uint16_t, _pw_h);
+
+// Writes 4 bytes at once where the row is aligned for it.
+typedef uint32_t __attribute__((__may_alias__)) PixelWord;
+
+FrameBuffer frameBuffer(DisplayType& display) {
+	FrameBuffer fb;
+	fb.bytes = display.*member(BufferMember());
+	fb.x = display.*member(WindowXMember());
+	fb.y = display.*member(WindowYMember());
+	fb.w = display.*member(WindowWMember());
+	fb.h = display.*member(WindowHMember());
+	fb.width = display.width();
+	fb.height = display.height();
+	fb.rotation = display.getRotation();
+	return fb;
+}
+
+// Logical to panel coordinates, as GxEPD2_BW::drawPixel().
+static void toPanel(const FrameBuffer& fb, int16_t& x, int16_t& y) {
+	const int16_t W = GxEPD2_397_GDEM0397T81::WIDTH;
+	const int16_t H = GxEPD2_397_GDEM0397T81::HEIGHT;
+	switch (fb.rotation) {
+		case 1: std::swap(x, y); x = W - x - 1; break;
+		case 2: x = W - x - 1; y = H - y - 1; break;
+		case 3: std::swap(x, y); y = H - y - 1; break;
+	}
+}
+
+bool frameBufferPixel(const FrameBuffer& fb, int16_t x, int16_t y) {
+	if (x < 0 || x >= fb.width || y < 0 || y >= fb.height) return false;
+	toPanel(fb, x, y);
+	x -= fb.x;
+	y -= fb.y;
+	if (x < 0 || x >= fb.w || y < 0 || y >= fb.h) return false;
+	return !(fb.bytes[x / 8 + y * (fb.w / 8)] & (0x80 >> (x % 8)));
+}
+
+uint32_t boxInk(const FrameBuffer& fb, int16_t x1, int16_t x2, int16_t y1, int16_t y2, uint32_t* hash) {
+	*hash = 2166136261u;
+	x1 = std::max<int16_t>(x1, 0);
+	y1 = std::max<int16_t>(y1, 0);
+	x2 = std::min<int16_t>(x2, fb.width - 1);
+	y2 = std::min<int16_t>(y2, fb.height - 1);
+	if (x1 > x2 || y1 > y2) return 0;
+	toPanel(fb, x1, y1);
+	toPanel(fb, x2, y2);
+	int px1 = std::max<int>(std::min(x1, x2), fb.x) - fb.x;
+	int px2 = std::min<int>(std::max(x1, x2), fb.x + fb.w - 1) - fb.x;
+	int py1 = std::max<int>(std::min(y1, y2), fb.y) - fb.y;
+	int py2 = std::min<int>(std::max(y1, y2), fb.y + fb.h - 1) - fb.y;
+	if (px1 > px2 || py1 > py2) return 0;
+
+	int first = px1 / 8, last = px2 / 8;
+	uint8_t firstMask = 0xFF >> (px1 % 8), lastMask = 0xFF << (7 - px2 % 8);
+	uint32_t ink = 0;
+	for (int y = py1; y <= py2; y++) {
+		const uint8_t* row = fb.bytes + y * (fb.w / 8);
+		for (int i = first; i <= last; i++) {
+			uint8_t black = ~row[i];
+			if (i == first) black &= firstMask;
+			if (i == last) black &= lastMask;
+			ink += __builtin_popcount(black);
+			*hash = (*hash ^ black) * 16777619u; // FNV-1a
+		}
+	}
+	return ink;
+}
+
+static uint8_t reverseNibble(uint8_t n) {
+	return ((n & 1) << 3) | ((n & 2) << 1) | ((n & 4) >> 1) | ((n & 8) >> 3);
+}
+
+// Rows k = 0 .. count - 1 take patterns[k * patternStride].
+static void paintRows(FrameBuffer& fb, int16_t x1, int16_t x2, int16_t y, int8_t step, const uint8_t* patterns, int patternStride, int count) {
+	x1 = std::max<int16_t>(x1, 0);
+	x2 = std::min<int16_t>(x2, fb.width - 1);
+	if (x1 > x2) return;
+
+	// Portrait rotations turn the rows into panel columns: one bit per byte.
+	if (fb.rotation & 1) {
+		for (int k = 0; k < count; k++, y += step) {
+			if (y < 0 || y >= fb.height) continue;
+			uint8_t pattern = patterns[k * patternStride];
+			for (int16_t x = x1; x <= x2; x++) {
+				if (!((pattern >> (3 - x % 4)) & 1)) continue;
+				int16_t px = x, py = y;
+				toPanel(fb, px, py);
+				px -= fb.x;
+				py -= fb.y;
+				if (px < 0 || px >= fb.w || py < 0 || py >= fb.h) continue;
+				fb.bytes[px / 8 + py * (fb.w / 8)] &= ~(0x80 >> (px % 8));
+			}
+		}
+		return;
+	}
+
+	// The columns map to the same panel bytes on every row. Both panel sides
+	// are multiples of 4, so under rotation 2 the pattern phase only flips:
+	// the nibble is mirrored, not shifted.
+	int16_t px1 = x1, px2 = x2, py = y, unused = y;
+	toPanel(fb, px1, py);
+	toPanel(fb, px2, unused);
+	if (px1 > px2) std::swap(px1, px2);
+	px1 = std::max<int16_t>(px1 - fb.x, 0);
+	px2 = std::min<int16_t>(px2 - fb.x, fb.w - 1);
+	if (px1 > px2) return;
+	bool mirrored = fb.rotation == 2;
+	int panelStep = mirrored ? -step : step;
+
+	int stride = fb.w / 8;
+	int first = px1 / 8;
+	int last = px2 / 8;
+	uint8_t headMask = 0xFF >> (px1 % 8);
+	uint8_t tailMask = 0xFF << (7 - px2 % 8);
+	if (first == last) headMask &= tailMask;
+
+	py -= fb.y;
+	for (int k = 0; k < count; k++, y += step, py += panelStep) {
+		uint8_t pattern = patterns[k * patternStride];
+		if (!pattern || y < 0 || y >= fb.height || py < 0 || py >= fb.h) continue;
+		uint8_t nibble = mirrored ? reverseNibble(pattern) : pattern;
+		uint8_t ink = nibble | (nibble << 4); // the window starts on a byte
+		uint8_t* row = fb.bytes + py * stride;
+		row[first] &= ~(ink & headMask);
+		if (first == last) continue;
+
+		int i = first + 1;
+		while (i < last && (reinterpret_cast<uintptr_t>(row + i) & 3)) row[i++] &= ~ink;
+		uint32_t inkWord = ink * 0x01010101u;
+		for (; i + 4 <= last; i += 4) *reinterpret_cast<PixelWord*>(row + i) &= ~inkWord;
+		while (i < last) row[i++] &= ~ink;
+		row[last] &= ~(ink & tailMask);
+	}
+}
+
+void fillPatternRows(FrameBuffer& fb, int16_t x1, int16_t x2, int16_t y, int8_t step, const uint8_t* patterns, int count) {
+	paintRows(fb, x1, x2, y, step, patterns, 1, count);
+}
+
+void fillBox(FrameBuffer& fb, int16_t x1, int16_t x2, int16_t y1, int16_t y2) {
+	static const uint8_t SOLID = 0b1111;
+	if (x1 > x2) std::swap(x1, x2);
+	if (y1 > y2) std::swap(y1, y2);
+	paintRows(fb, x1, x2, y1, 1, &SOLID, 0, y2 - y1 + 1);
+}
+
+/*
+ * Each segment covers, per column, the rows whose centres its centre line
+ * crosses within the column, plus the row nearest to the line at the
+ * column's centre. The line Y is stepped in Q16. At a shared column the
+ * spans of both segments are merged, and neighbouring columns with the same
+ * span are filled as one box.
+*/
+void fillThickPolyline(FrameBuffer& fb, const int16_t* xs, const int16_t* ys, int count, int16_t halfWidth) {
+	int runStart = 0, runEnd = 0, runTop = 0, runBottom = -1;
+	int joinTop = 0, joinBottom = -1;
+	for (int i = 0; i + 1 < count; i++) {
+		int x1 = xs[i], x2 = xs[i + 1];
+		int dx = x2 - x1;
+		int32_t y1 = int32_t(ys[i]) << 16;
+		int32_t halfSlope = dx > 0 ? ((int32_t(ys[i + 1]) - ys[i]) << 16) / (2 * dx) : 0;
+		bool last = i + 2 == count;
+
+		for (int u = 0; u <= dx; u++) {
+			int top, bottom;
+			if (dx == 0) {
+				top = std::min(ys[i], ys[i + 1]);
+				bottom = std::max(ys[i], ys[i + 1]);
+			} else {
+				int32_t centre = y1 + halfSlope * 2 * u;
+				int32_t from = y1 + halfSlope * std::max(2 * u - 1, 0);
+				int32_t to = y1 + halfSlope * std::min(2 * u + 1, 2 * dx);
+				int nearest = (centre + 0x8000) >> 16;
+				top = std::min<int>(nearest, (std::min(from, to) + 0xFFFF) >> 16);
+				bottom = std::max<int>(nearest, std::max(from, to) >> 16);
+			}
+
+			// The end column is drawn with the next segment's start.
+			if (u == dx && !last) {
+				joinTop = top;
+				joinBottom = bottom;
+				break;
+			}
+			if (u == 0 && i > 0) {
+				top = std::min(top, joinTop);
+				bottom = std::max(bottom, joinBottom);
+			}
+
+			int column = x1 + u;
+			if (top == runTop && bottom == runBottom && column == runEnd + 1) {
+				runEnd = column;
+				continue;
+			}
+			if (runBottom >= runTop) fillBox(fb, runStart, runEnd, runTop - halfWidth, runBottom + halfWidth);
+			runStart = runEnd = column;
+			runTop = top;
+			runBottom = bottom;
+		}
+	}
+	if (runBottom >= runTop) fillBox(fb, runStart, runEnd, runTop - halfWidth, runBottom + halfWidth);
+}
+
+static uint8_t reverseByte(uint8_t b) {
+	return (reverseNibble(b & 0x0F) << 4) | reverseNibble(b >> 4);
+}
+
+static const uint8_t* reversedBytes() {
+	static uint8_t reversed[256];
+	static bool ready = false;
+	if (!ready) {
+		for (int b = 0; b < 256; b++) reversed[b] = reverseByte(b);
+		ready = true;
+	}
+	return reversed;
+}
+
+// Portrait rotations: one pixel at a time through toPanel().
+static void paintBitmapByte(FrameBuffer& fb, int16_t x, int16_t y, uint8_t bits) {
+	for (int16_t i = 0; i < 8; i++) {
+		if (!(bits & (0x80 >> i))) continue;
+		int16_t px = x + i, py = y;
+		if (px < 0 || px >= fb.width || py < 0 || py >= fb.height) continue;
+		toPanel(fb, px, py);
+		px -= fb.x;
+		py -= fb.y;
+		if (px < 0 || px >= fb.w || py < 0 || py >= fb.h) continue;
+		fb.bytes[px / 8 + py * (fb.w / 8)] &= ~(0x80 >> (px % 8));
+	}
+}
+
+void blitBitmap(FrameBuffer& fb, int16_t x, int16_t y, const uint8_t* bitmap, int16_t w, int16_t h) {
+	int bytesPerRow = w / 8;
+
+	if (fb.rotation & 1) {
+		for (int16_t j = 0; j < h; j++) {
+			for (int16_t i = 0; i < bytesPerRow; i++) paintBitmapByte(fb, x + 8 * i, y + j, bitmap[j * bytesPerRow + i]);
+		}
+		return;
+	}
+
+	bool mirrored = fb.rotation == 2;
+	const uint8_t* reversed = mirrored ? reversedBytes() : nullptr;
+
+	// Top left corner of the bitmap on the panel, relative to the window.
+	int left = mirrored ? GxEPD2_397_GDEM0397T81::WIDTH - x - w : x;
+	int top = mirrored ? GxEPD2_397_GDEM0397T81::HEIGHT - y - h : y;
+	left -= fb.x;
+	top -= fb.y;
+	int stride = fb.w / 8;
+	int first = left >> 3; // floor, also left of the window
+	int shift = left & 7;
+
+	for (int r = 0; r < h; r++) {
+		int py = top + r;
+		if (py < 0 || py >= fb.h) continue;
+		const uint8_t* source = bitmap + (mirrored ? h - 1 - r : r) * bytesPerRow;
+		uint8_t* row = fb.bytes + py * stride;
+		uint8_t carry = 0;
+		for (int j = 0; j <= bytesPerRow; j++) {
+			uint8_t bits = 0;
+			if (j < bytesPerRow) bits = mirrored ? reversed[source[bytesPerRow - 1 - j]] : source[j];
+			uint8_t ink = (bits >> shift) | carry;
+			carry = shift ? uint8_t(bits << (8 - shift)) : 0;
+			int column = first + j;
+			if (ink && column >= 0 && column < stride) row[column] &= ~ink;
+		}
+	}
+}
+
+/*
+ * Same placement as blitBitmap(), but every byte is written where it lands
+ * as it comes out of the stream, so nothing is unpacked into a buffer. A
+ * byte straddles two panel bytes when X is unaligned; zero runs are skipped.
+*/
+void blitPackedBitmap(FrameBuffer& fb, int16_t x, int16_t y, const uint8_t* packed, int16_t w, int16_t h) {
+	int bytesPerRow = w / 8;
+	int size = bytesPerRow * h;
+	bool portrait = fb.rotation & 1;
+	bool mirrored = fb.rotation == 2;
+	const uint8_t* reversed = mirrored ? reversedBytes() : nullptr;
+
+	int left = (mirrored ? GxEPD2_397_GDEM0397T81::WIDTH - x - w : x) - fb.x;
+	int top = (mirrored ? GxEPD2_397_GDEM0397T81::HEIGHT - y - h : y) - fb.y;
+	int stride = fb.w / 8;
+
+	auto paint = [&](int i, uint8_t bits) {
+		int r = i / bytesPerRow;
+		int j = i - r * bytesPerRow;
+		if (portrait) {
+			paintBitmapByte(fb, x + 8 * j, y + r, bits);
+			return;
+		}
+		int py = mirrored ? top + h - 1 - r : top + r;
+		if (py < 0 || py >= fb.h) return;
+		int px = mirrored ? left + w - 8 * (j + 1) : left + 8 * j;
+		if (mirrored) bits = reversed[bits];
+		uint8_t* row = fb.bytes + py * stride;
+		int column = px >> 3; // floor, also left of the window
+		int shift = px & 7;
+		if (column >= 0 && column < stride) row[column] &= ~(bits >> shift);
+		if (shift && column + 1 >= 0 && column + 1 < stride) row[column + 1] &= ~uint8_t(bits << (8 - shift));
+	};
+
+	int i = 0;
+	while (i < size) {
+		uint8_t n = *packed++;
+		if (n < 128) {
+			for (int k = 0; k <= n; k++, i++) {
+				uint8_t bits = *packed++;
+				if (bits) paint(i, bits);
+			}
+		} else if (n > 128) {
+			uint8_t bits = *packed++;
+			int run = 257 - n;
+			if (bits) {
+				for (int k = 0; k < run; k++) paint(i + k, bits);
+			}
+			i += run;
+		}
+	}
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include "rendering.h"
+
+/**
+ * Direct access to the GxEPD2_BW buffer
+ *
+ * Adafruit GFX draws one pixel per virtual drawPixel() call, each doing the
+ * rotation, window and page checks again. The span fills here map a whole
+ * logical row to the physical buffer once and then write 8 or 32 pixels at
+ * a time. Pixels land exactly where drawPixel() would put them.
+ *
+ * GxEPD2_BW keeps its buffer private. DisplayType is a single page buffer
+ * (page_height == HEIGHT) of an unmirrored panel, so the partial window is
+ * all that is needed to address it. The private members are those of
+ * GxEPD2 1.5.9; platformio.ini pins that version.
+**/
+
+struct FrameBuffer {
+	uint8_t* bytes;      // 1 = white, MSB first, _pw_w / 8 bytes per row
+	int16_t x, y, w, h;  // partial window in panel coordinates
+	int16_t width;       // logical size, after rotation
+	int16_t height;
+	uint8_t rotation;
+};
+
+FrameBuffer frameBuffer(DisplayType& display);
+
+// True if the logical pixel is black.
+bool frameBufferPixel(const FrameBuffer& fb, int16_t x, int16_t y);
+
+/*
+ * Black pixels in the logical box, corners inclusive, read a byte at a time.
+ * `hash` gets an FNV-1a hash of the box's panel bytes with everything outside
+ * the box masked off, so it only changes when the box's pixels do. Only the
+ * part inside the partial window is seen.
+*/
+uint32_t boxInk(const FrameBuffer& fb, int16_t x1, int16_t x2, int16_t y1, int16_t y2, uint32_t* hash);
+
+/*
+ * Paints black between x1 and x2 (inclusive) on `count` logical rows,
+ * starting at y and moving by `step` (1 or -1), where the row's 4 px pattern
+ * has ones. Bit 3 of a pattern is the pixel at x % 4 == 0, as in
+ * ditherPatterns; 0b1111 fills the span. The panel bytes and edge masks are
+ * worked out once for all the rows.
+*/
+void fillPatternRows(FrameBuffer& fb, int16_t x1, int16_t x2, int16_t y, int8_t step, const uint8_t* patterns, int count);
+
+inline void fillPatternSpan(FrameBuffer& fb, int16_t x1, int16_t x2, int16_t y, uint8_t pattern) {
+	fillPatternRows(fb, x1, x2, y, 1, &pattern, 1);
+}
+
+// Solid black box, corners inclusive.
+void fillBox(FrameBuffer& fb, int16_t x1, int16_t x2, int16_t y1, int16_t y2);
+
+/*
+ * Polyline through count points with ascending xs, 2 * halfWidth + 1 px
+ * thick vertically. Every column is filled once, joins included.
+*/
+void fillThickPolyline(FrameBuffer& fb, const int16_t* xs, const int16_t* ys, int count, int16_t halfWidth);
+
+/*
+ * Paints the 1 bits of an MSB-first bitmap black and leaves the 0 bits, as
+ * GFX drawBitmap() does; w is a multiple of 8. Rows are merged into the
+ * buffer a byte at a time, shifted for unaligned X. Under rotation 2 the
+ * 180° turn is a reversed row order and bit-reversed bytes, so the source
+ * is read backwards through a table instead of transforming each pixel.
+*/
+void blitBitmap(FrameBuffer& fb, int16_t x, int16_t y, const uint8_t* bitmap, int16_t w, int16_t h);
+
+/*
+ * blitBitmap() from a PackBits stream (see tools/pack_assets.py), unpacked
+ * straight into the buffer: a header n < 128 is followed by n + 1 literal
+ * bytes, n > 128 by one byte repeated 257 - n times.
+*/
+void blitPackedBitmap(FrameBuffer& fb, int16_t x, int16_t y, const uint8_t* packed, int16_t w, int16_t h);
@@ -0,0 +1,50 @@
+#include "glyphs.h"
+
+static const AtlasGlyph* findGlyph(const GlyphAtlas& atlas, char c) {
+	for (uint8_t i = 0; i < atlas.count; i++) {
+		if (atlas.glyphs[i].character == static_cast<uint8_t>(c)) return &atlas.glyphs[i];
+	}
+	return nullptr;
+}
+
+int16_t textAdvance(const GlyphAtlas& atlas, const String& text) {
+	int16_t advance = 0;
+	for (unsigned int i = 0; i < text.length(); i++) {
+		const AtlasGlyph* glyph = findGlyph(atlas, text[i]);
+		if (glyph) advance += glyph->xAdvance;
+	}
+	return advance;
+}
+
+void textBounds(const GlyphAtlas& atlas, const String& text, int16_t x, int16_t y, int16_t* x1, int16_t* y1, uint16_t* w, uint16_t* h) {
+	// Empty glyphs count too, as in GFX charBounds().
+	int16_t minX = 0x7FFF, minY = 0x7FFF, maxX = -1, maxY = -1;
+	for (unsigned int i = 0; i < text.length(); i++) {
+		const AtlasGlyph* glyph = findGlyph(atlas, text[i]);
+		if (!glyph) continue;
+		int16_t left = x + glyph->xOffset;
+		int16_t top = y + glyph->yOffset;
+		minX = std::min<int16_t>(minX, left);
+		minY = std::min<int16_t>(minY, top);
+		maxX = std::max<int16_t>(maxX, left + glyph->width - 1);
+		maxY = std::max<int16_t>(maxY, top + glyph->height - 1);
+		x += glyph->xAdvance;
+	}
+	*x1 = x;
+	*y1 = y;
+	*w = *h = 0;
+	if (maxX >= minX) { *x1 = minX; *w = maxX - minX + 1; }
+	if (maxY >= minY) { *y1 = minY; *h = maxY - minY + 1; }
+}
+
+void drawText(FrameBuffer& fb, const GlyphAtlas& atlas, int16_t x, int16_t y, const String& text) {
+	for (unsigned int i = 0; i < text.length(); i++) {
+		const AtlasGlyph* glyph = findGlyph(atlas, text[i]);
+		if (!glyph) continue;
+		if (glyph->width > 0 && glyph->height > 0) {
+			int16_t paddedWidth = (glyph->width + 7) & ~7;
+			blitPackedBitmap(fb, x + glyph->xOffset, y + glyph->yOffset, atlas.bitmap + glyph->offset, paddedWidth, glyph->height);
+		}
+		x += glyph->xAdvance;
+	}
+}
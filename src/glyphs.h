@@ -0,0 +1,39 @@
+#pragma once
+#include "framebuffer.h"
+
+/**
+ * Glyph atlas
+ *
+ * The characters the display renders (digits, " -.:%C") cut out of the
+ * Adafruit GFX fonts at build time by tools/pack_assets.py, with each row
+ * padded to whole bytes and every glyph PackBits compressed for
+ * blitPackedBitmap(). Metrics are the font's own, so layout is a table
+ * lookup and matches getTextBounds() and print(). Characters outside the
+ * atlas are skipped.
+**/
+
+struct AtlasGlyph {
+	uint8_t character;
+	uint16_t offset;    // of the packed glyph, (width + 7) / 8 bytes per row unpacked
+	uint8_t width;
+	uint8_t height;
+	uint8_t xAdvance;
+	int8_t xOffset;     // from the cursor to the top left corner
+	int8_t yOffset;
+};
+
+struct GlyphAtlas {
+	const uint8_t* bitmap;
+	const AtlasGlyph* glyphs;
+	uint8_t count;
+	uint8_t yAdvance;
+};
+
+// Cursor advance over the text, i.e. its typographic width.
+int16_t textAdvance(const GlyphAtlas& atlas, const String& text);
+
+// Ink bounds of the text printed at (x, y), as GFX getTextBounds().
+void textBounds(const GlyphAtlas& atlas, const String& text, int16_t x, int16_t y, int16_t* x1, int16_t* y1, uint16_t* w, uint16_t* h);
+
+// Draws the text with its cursor (baseline start) at (x, y), as setCursor() and print().
+void drawText(FrameBuffer& fb, const GlyphAtlas& atlas, int16_t x, int16_t y, const String& text);
@@ -8,34 +8,123 @@
 #include <Adafruit_BMP280.h>
 #include <SensirionI2CScd4x.h>
 #include <GxEPD2_BW.h>
-#include <ArduinoJson.h>
 #include "rendering.h"
+#include "profiler.h"
+#include "telemetry.h"
+#include "forecast.h"
+#include "tls_client.h"
+#include "wifi_health.h"
+#include "wake_budget.h"
 #include <esp_sleep.h>
+#include <esp_rom_crc.h>
+#include <driver/gpio.h>
+#include <freertos/event_groups.h>
 
 #define LOGGING_ENABLED false
 
+// SCD40 acquisition, pick one per build with -D SCD_MODE=...
+#define SCD_MODE_PERIODIC 0      // start periodic, read the first conversion, stop
+#define SCD_MODE_SINGLE_SHOT 1   // measure_single_shot, sensor idles between wakes
+#define SCD_MODE_POWER_DOWN 2    // single shot, sensor in power_down between wakes
+#ifndef SCD_MODE
+#define SCD_MODE SCD_MODE_POWER_DOWN
+#endif
+
+// Open-Meteo response format; FlatBuffers falls back to JSON if it fails.
+#define FORECAST_FORMAT_JSON 0
+#define FORECAST_FORMAT_FLATBUFFERS 1
+#ifndef FORECAST_FORMAT
+#define FORECAST_FORMAT FORECAST_FORMAT_FLATBUFFERS
+#endif
+
+// Hours between forecast fetches, -D FORECAST_FETCH_HOURS=... In between the
+// drawn day slides over the 48 h cache, see forecastWindow().
+#ifndef FORECAST_FETCH_HOURS
+#define FORECAST_FETCH_HOURS 6
+#endif
+
 const unsigned long UPDATE_INTERVAL_MS = 300 * 1000; // because of scd40 it must be > 30s
-const unsigned long WEATHER_UPDATE_INTERVAL_MS = 3600 * 1000;
+const unsigned long SCD_MEASUREMENT_MS = 5000;
+const unsigned long WIFI_CONNECT_LEAD_MS = 1500; // start WiFi this long before the CO2 reading is due
+const unsigned long WIFI_FAST_CONNECT_LEAD_MS = 500; // same, when the cached AP is used
+const int WIFI_FAST_CONNECT_TIMEOUT_MS = 1000; // then fall back to a full scan
+const uint8_t WIFI_REVALIDATE_CONNECTS = 24; // scan + DHCP again after this many fast connects
+const uint8_t UPLOAD_EVERY_CYCLES = 6; // readings per ThingSpeak bulk update
+const float LOW_BATTERY_VOLTAGE = 3.5f; // upload every reading below this
+
+const uint32_t FORECAST_FETCH_S = FORECAST_FETCH_HOURS * 3600;
+const uint32_t FORECAST_RETRY_S = 3600; // after a failed fetch
+const uint32_t FORECAST_STALE_S = 18 * 3600; // icon_d2 leaves 43+ h, so the cache runs out from 19 h on, retry sooner
+const uint32_t FORECAST_STALE_RETRY_S = 900;
+static_assert(FORECAST_FETCH_HOURS >= 1 && FORECAST_FETCH_S <= FORECAST_STALE_S, "the window must not run past the cache between fetches");
+
+// Time the wake budget keeps for each step, see wake_budget.h.
+const uint32_t DISPLAY_RESERVE_MS = GxEPD2_397_GDEM0397T81::full_refresh_time; // drawing after the forecast
+const uint32_t SCD_FRC_MS = 1000; // settle + forced recalibration
+const uint32_t FORECAST_MIN_MS = 1500; // connect, handshake and the response
+const uint32_t UPLOAD_MIN_MS = 500;
+const uint32_t HTTP_TIMEOUT_MS = 5000; // HTTPClient's default
 
 
 DisplayType display(GxEPD2_397_GDEM0397T81(EPD_CS_PIN, EPD_DC_PIN, EPD_RST_PIN, EPD_BUSY_PIN));
 Adafruit_AHTX0 aht;
 Adafruit_BMP280 bmp;
 SensirionI2cScd4x scd4x;
-
-const int FORECAST_HOURS = 24;
+ResumableTlsClient forecastClient; // mbedTLS contexts, kept off the network task's stack
 
 float tempAir = 0, humidity = 0, tempESP = 0, pressure = 1000, batteryVoltage = 0, co2 = 0, moonPhase = 0;
 
-RTC_DATA_ATTR float rtc_forecastTemp[FORECAST_HOURS];
-RTC_DATA_ATTR float rtc_forecastRain[FORECAST_HOURS];
-RTC_DATA_ATTR char rtc_sunriseTimeStr[6] = "--:--";
-RTC_DATA_ATTR char rtc_sunsetTimeStr[6] = "--:--";
-RTC_DATA_ATTR int rtc_forecastStartHour = 0;
-RTC_DATA_ATTR bool rtc_weatherDataValid = false;
-RTC_DATA_ATTR uint32_t rtc_bootCount = 0;
-RTC_DATA_ATTR uint32_t rtc_bootsFromLastForecastFetch = 0;
-RTC_DATA_ATTR uint32_t rtc_weatherFetchTimestamp = 0;
+// Last good association, to skip the scan and DHCP on the next wake.
+struct __attribute__((packed)) WiFiCache {
+  bool valid;
+  uint8_t fastConnects;
+  uint8_t bssid[6];
+  uint8_t channel;
+  uint32_t localIP;
+  uint32_t gateway;
+  uint32_t subnet;
+  uint32_t dns;
+};
+
+// Everything this file keeps across deep sleep, sealed with a CRC before
+// sleeping and checked on wake. RTC memory garbled by a brownout, or left
+// by firmware with another layout, fails the check and every module starts
+// over as on power-up, instead of drawing from garbage.
+#define RTC_STATE_VERSION 3
+struct __attribute__((packed)) RtcState {
+  uint16_t version;
+  uint16_t size;
+  uint32_t bootCount;
+  uint32_t forecastFetchedS;  // clockMs / 1000 at the wake that fetched the cached forecast
+  uint32_t forecastTriedS;    // same, of the last attempt whether it worked or not
+  uint16_t forecastIntoHourS; // how far the cached forecast's first hour had run by forecastFetchedS
+  uint64_t clockMs;           // awake + asleep time since power-up
+  int16_t shownCo2;           // CO2 on the panel, known before the conversion ends
+  bool co2Steady;             // last reading matched it at display precision
+  bool weatherDataValid;
+  PackedForecast forecast;
+  WiFiCache wifiCache;
+  uint32_t crc;               // of everything above
+};
+RTC_DATA_ATTR RtcState rtc_state;
+
+Forecast forecast; // rtc_state.forecast, unpacked on wake
+ForecastWindow shownForecast; // the day of it drawn this hour
+bool forecastShown = false; // false hides the forecast: none yet, or the cache ran out
+
+bool largeUpdate = false;
+bool uploadDue = false;
+bool refreshDue = false;
+volatile bool networkRunning = false; // light sleep would drop the connection
+RefreshAction refreshAction = REFRESH_SKIP;
+unsigned long scdStartMs = 0;
+unsigned long scdReadyAtMs = 0;
+
+// The network task and setup() hand over through these bits.
+EventGroupHandle_t wakeEvents;
+const EventBits_t EVENT_FORECAST_DONE = BIT0;
+const EventBits_t EVENT_READINGS_READY = BIT1;
+const EventBits_t EVENT_UPLOAD_DONE = BIT2;
 
 // ################################ Moon Phase #################################
 
@@ -43,7 +132,7 @@ RTC_DATA_ATTR uint32_t rtc_weatherFetchTimestamp = 0;
 void getMoonPhase() {
   const uint32_t FULL_MOON_REF = 1763614318;
   const uint32_t LUNAR_CYCLE = 2551443; // 29.53 days in seconds
-  uint32_t currentTime = rtc_weatherFetchTimestamp;
+  uint32_t currentTime = shownForecast.startTimestamp;
   uint32_t elapsed = currentTime - FULL_MOON_REF;
   moonPhase = (float)(elapsed % LUNAR_CYCLE) / (float)LUNAR_CYCLE;
 }
@@ -51,6 +140,7 @@ void getMoonPhase() {
 // ################################ Sensors ####################################
 
 void initSensors() {
+  ProfileScope profile(PHASE_INIT_SENSORS);
   Wire.begin(I2C_SDA_PIN, I2C_SCL_PIN, 100000);
   delay(1);
   
@@ -67,7 +157,11 @@ void initSensors() {
   }
   
   scd4x.begin(Wire, SCD40_I2C_ADDR_62);
-  delay(30);
+  #if SCD_MODE == SCD_MODE_POWER_DOWN
+    scd4x.wakeUp(); // not acknowledged by the sensor, includes the 30 ms wait
+  #else
+    delay(30);
+  #endif
 
   analogReadResolution(12);
   analogSetAttenuation(ADC_11db);
@@ -75,6 +169,7 @@ void initSensors() {
 }
 
 void readSensorBMP(){
+  ProfileScope profile(PHASE_READ_BMP);
   // Configure BMP280 for forced mode before measurement
   bmp.setSampling(Adafruit_BMP280::MODE_FORCED,
                   Adafruit_BMP280::SAMPLING_X1,  // temperature
@@ -91,6 +186,7 @@ void readSensorBMP(){
 }
 
 void readSensorAHT(){
+  ProfileScope profile(PHASE_READ_AHT);
   sensors_event_t hum, temp;
   aht.getEvent(&hum, &temp);
   tempAir = temp.temperature;
@@ -100,12 +196,37 @@ void readSensorAHT(){
   if(tempAir < -40 || tempAir > 85) tempAir = -3.0f;
 }
 
-void readSensorSCD(){
+// The driver's measureSingleShot() blocks for the whole conversion, so the
+// command is sent directly and the result collected by finishSensorSCD().
+uint8_t sendCommandSCD(uint16_t command) {
+  Wire.beginTransmission(SCD40_I2C_ADDR_62);
+  Wire.write(command >> 8);
+  Wire.write(command & 0xFF);
+  return Wire.endTransmission();
+}
+
+// Starts the 5 s conversion; finishSensorSCD() collects it once it is due,
+// so the rest of the wake can run in the meantime.
+void startSensorSCD(){
   #if LOGGING_ENABLED
     Serial.println("Initializing SCD40");
   #endif
+  scdStartMs = millis();
+
+  #if SCD_MODE == SCD_MODE_POWER_DOWN
+    // The first conversion after wake_up reads high, flush it with a 50 ms
+    // RH/T-only shot rather than a 5 s CO2 one.
+    uint16_t _co2Raw;
+    float _tempSCD, _humSCD;
+    scd4x.measureSingleShotRhtOnly();
+    scd4x.readMeasurement(_co2Raw, _tempSCD, _humSCD);
+  #endif
 
-  uint16_t error = scd4x.startPeriodicMeasurement();
+  #if SCD_MODE == SCD_MODE_PERIODIC
+    uint16_t error = scd4x.startPeriodicMeasurement();
+  #else
+    uint16_t error = sendCommandSCD(0x219D); // measure_single_shot
+  #endif
   if (error == 0) {
     #if LOGGING_ENABLED
       Serial.println("SCD40 started successfully");
@@ -117,16 +238,15 @@ void readSensorSCD(){
     #endif
   }
 
-  uint16_t _co2Raw;
+  scdReadyAtMs = millis() + SCD_MEASUREMENT_MS;
+}
+
+void finishSensorSCD(const WakeBudget& budget){
+  if (millis() < scdReadyAtMs) {
+    delay(scdReadyAtMs - millis()); // lets the network task run
+  }
+
   float _tempSCD, _humSCD;
-  
-  scd4x.readMeasurement(_co2Raw, _tempSCD, _humSCD);
-  #if LOGGING_ENABLED
-  delay(5000);
-  #else  
-  esp_sleep_enable_timer_wakeup(5000000); // ms
-  esp_light_sleep_start();
-  #endif
   bool dataReady = false;
   scd4x.getDataReadyStatus(dataReady);
   
@@ -142,14 +262,25 @@ void readSensorSCD(){
     co2 = -1.0f;
   }
 
-  scd4x.stopPeriodicMeasurement();
+  #if SCD_MODE == SCD_MODE_PERIODIC
+    scd4x.stopPeriodicMeasurement();
+  #endif
 
-  if (co2 >= 0 && co2 < 300) {
+  // Below outdoor CO2 the sensor has drifted. Recalibration waits for a
+  // wake with time to spare, the reading stays low until then.
+  if (co2 >= 0 && co2 < 300 && budget.allows(SCD_FRC_MS, DISPLAY_RESERVE_MS)) {
     delay(500);
     uint16_t frcCorrection;
     scd4x.performForcedRecalibration(400, frcCorrection);
   }
 
+  #if SCD_MODE == SCD_MODE_POWER_DOWN
+    scd4x.powerDown();
+  #endif
+
+  // Start of acquisition to reading, whatever ran in between.
+  profilerAdd(PHASE_READ_SCD, millis() - scdStartMs);
+
   if(co2 > 10000) co2 = -3.0f;
 }
 
@@ -166,153 +297,324 @@ void readSensors() {
   tempESP = temperatureRead();
   readSensorBMP();
   readSensorAHT();
-  readSensorSCD();
+  startSensorSCD();
+}
+
+// Light sleep halts every task, only use it while nothing else is running.
+void sleepUntil(unsigned long atMs) {
+  if (millis() >= atMs) return;
+  #if LOGGING_ENABLED
+  delay(atMs - millis());
+  #else
+  esp_sleep_enable_timer_wakeup((atMs - millis()) * 1000ULL);
+  esp_light_sleep_start();
+  #endif
 }
 
 // ############################### Internet ####################################
 
+bool fastConnecting = false;
+unsigned long wifiStartMs = 0;
+unsigned long wifiDeadlineMs = 0; // one attempt per wake, however many steps wait for it
+bool wifiReported = false;
+
+bool canFastConnect() {
+  return rtc_state.wifiCache.valid && rtc_state.wifiCache.fastConnects < WIFI_REVALIDATE_CONNECTS;
+}
+
 void connectWiFi() {
+  ProfileScope profile(PHASE_WIFI);
+  WiFi.persistent(false);
   WiFi.mode(WIFI_STA);
   WiFi.setTxPower(WIFI_POWER_5dBm);
   WiFi.setSleep(WIFI_PS_NONE);
-  WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
+
+  wifiStartMs = millis();
+  wifiDeadlineMs = wifiStartMs + wifiConnectTimeoutMs();
+  wifiReported = false;
+  fastConnecting = canFastConnect();
+  if (fastConnecting) {
+    rtc_state.wifiCache.fastConnects++;
+    WiFi.config(rtc_state.wifiCache.localIP, rtc_state.wifiCache.gateway, rtc_state.wifiCache.subnet, rtc_state.wifiCache.dns);
+    WiFi.begin(WIFI_SSID, WIFI_PASSWORD, rtc_state.wifiCache.channel, rtc_state.wifiCache.bssid);
+  } else {
+    WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
+  }
 }
 
-void waitForWiFi(int timeoutMs = 10000) {
-  for (int i = 0; i < timeoutMs && WiFi.status() != WL_CONNECTED; i+=50){
+void saveWiFiCache() {
+  uint8_t* bssid = WiFi.BSSID();
+  if (bssid == NULL) return;
+  memcpy(rtc_state.wifiCache.bssid, bssid, sizeof(rtc_state.wifiCache.bssid));
+  rtc_state.wifiCache.channel = WiFi.channel();
+  rtc_state.wifiCache.localIP = WiFi.localIP();
+  rtc_state.wifiCache.gateway = WiFi.gatewayIP();
+  rtc_state.wifiCache.subnet = WiFi.subnetMask();
+  rtc_state.wifiCache.dns = WiFi.dnsIP(0);
+  rtc_state.wifiCache.fastConnects = 0;
+  rtc_state.wifiCache.valid = true;
+}
+
+// Waits until connected or the wake's connect deadline has passed, and
+// reports the outcome to the AP health model once. Running out of wake
+// budget first says nothing about the AP and is not reported.
+bool waitForWiFi(const WakeBudget& budget, uint32_t reserveMs) {
+  ProfileScope profile(PHASE_WIFI);
+  unsigned long budgetDeadlineMs = millis() + budget.timeoutMs(WIFI_TIMEOUT_MAX_MS, reserveMs);
+  while (WiFi.status() != WL_CONNECTED && millis() < wifiDeadlineMs && millis() < budgetDeadlineMs) {
+    // The AP moved or the address is gone, scan and ask DHCP instead.
+    if (fastConnecting && millis() - wifiStartMs >= WIFI_FAST_CONNECT_TIMEOUT_MS) {
+      fastConnecting = false;
+      rtc_state.wifiCache.valid = false;
+      WiFi.disconnect();
+      WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE);
+      WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
+    }
     delay(50);
   }
-  
+
+  bool connected = WiFi.status() == WL_CONNECTED;
+  if (connected && !fastConnecting) saveWiFiCache();
+  if (wifiReported || (!connected && millis() < wifiDeadlineMs)) return connected;
+  wifiReported = true;
+  if (connected) wifiReportConnected(millis() - wifiStartMs);
+  else wifiReportFailed(rtc_state.clockMs / 1000);
+
   #if LOGGING_ENABLED
-    if (WiFi.status() == WL_CONNECTED) {
+    if (connected) {
       Serial.println("WiFi OK");
     } else {
-      Serial.println("WiFi Failed");
+      Serial.print("WiFi Failed, retrying in ");
+      Serial.print(wifiHealth().retryAtS - rtc_state.clockMs / 1000);
+      Serial.println(" s");
     }
   #endif
+  return connected;
 }
 
-void fetchWeatherForecast() {
-  if (WiFi.status() != WL_CONNECTED) {
-    #if LOGGING_ENABLED
-      Serial.println("WiFi not connected, skipping weather update");
-    #endif
-    return;
-  }
+const char* FORECAST_URL = "https://api.open-meteo.com/v1/forecast?latitude=50.06&longitude=14.419998&timezone=Europe%2FBerlin&forecast_days=2&hourly=temperature_2m,rain,snowfall&daily=sunset,sunrise&forecast_hours=48&models=icon_d2";
+const int FORECAST_FLATBUFFER_MAX_BYTES = 2048; // 48 h is ~1 KB
+const char* FORECAST_HEADERS[] = {"Date"};
+
+// Seconds into the current hour at the start of this wake, by the server's
+// Date header ("Sat, 17 Oct 2026 10:50:12 GMT"). Europe/Berlin is a whole
+// number of hours off UTC, so its minutes are the local ones. 0 without a
+// Date, or when the wake started in the hour before.
+uint16_t wakeSecondsIntoHour(HTTPClient& http) {
+  String date = http.header("Date");
+  int colon = date.indexOf(':');
+  if (colon < 2 || (int)date.length() < colon + 6) return 0;
+  long intoHour = date.substring(colon + 1, colon + 3).toInt() * 60 + date.substring(colon + 4, colon + 6).toInt();
+  return max(0L, intoHour - (long)(millis() / 1000));
+}
+
+bool fetchForecastFlatBuffer(const WakeBudget& budget, uint16_t& intoHourS) {
+  HTTPClient http;
+  http.setConnectTimeout(budget.timeoutMs(HTTP_TIMEOUT_MS, DISPLAY_RESERVE_MS));
+  http.setTimeout(budget.timeoutMs(HTTP_TIMEOUT_MS, DISPLAY_RESERVE_MS));
+  http.useHTTP10(true);
+  http.begin(forecastClient, String(FORECAST_URL) + "&format=flatbuffers");
+  http.collectHeaders(FORECAST_HEADERS, 1);
   
+  int httpCode = http.GET();
+  int size = http.getSize();
+  bool ok = false;
+  if (httpCode == 200 && size > 0 && size <= FORECAST_FLATBUFFER_MAX_BYTES) {
+    uint8_t buffer[FORECAST_FLATBUFFER_MAX_BYTES];
+    ok = http.getStream().readBytes(buffer, size) == (size_t)size
+      && parseForecastFlatBuffer(buffer, size, forecast);
+    intoHourS = wakeSecondsIntoHour(http);
+  }
   #if LOGGING_ENABLED
-    Serial.println("Fetching weather forecast...");
+    if (!ok) {
+      Serial.print("FlatBuffers forecast failed, HTTP ");
+      Serial.println(httpCode);
+    }
   #endif
+  
+  http.end();
+  return ok;
+}
+
+bool fetchForecastJson(const WakeBudget& budget, uint16_t& intoHourS) {
   HTTPClient http;
-  http.begin("https://api.open-meteo.com/v1/forecast?latitude=50.06&longitude=14.419998&timezone=Europe%2FBerlin&forecast_days=1&hourly=temperature_2m,rain,snowfall&daily=sunset,sunrise&forecast_hours=24&models=icon_d2");
+  http.setConnectTimeout(budget.timeoutMs(HTTP_TIMEOUT_MS, DISPLAY_RESERVE_MS));
+  http.setTimeout(budget.timeoutMs(HTTP_TIMEOUT_MS, DISPLAY_RESERVE_MS));
+  http.useHTTP10(true); // no chunked encoding, so the body can be parsed off the stream
+  http.begin(forecastClient, FORECAST_URL);
+  http.collectHeaders(FORECAST_HEADERS, 1);
   
   int httpCode = http.GET();
-  if (httpCode == 200) {
-    String payload = http.getString();
-    
-    JsonDocument doc;
-    DeserializationError error = deserializeJson(doc, payload);
-    
+  if (httpCode != 200) {
+    #if LOGGING_ENABLED
+      Serial.print("HTTP error: ");
+      Serial.println(httpCode);
+    #endif
+    http.end();
+    return false;
+  }
+
+  DeserializationError error = parseForecast(http.getStream(), forecast);
+  intoHourS = wakeSecondsIntoHour(http);
+  #if LOGGING_ENABLED
     if (error) {
-      #if LOGGING_ENABLED
-        Serial.print("JSON parse error: ");
-        Serial.println(error.c_str());
-      #endif
-      http.end();
-      return;
+      Serial.print("JSON parse error: ");
+      Serial.println(error.c_str());
     }
-    
-    // Parse hourly temperature and rain
-    JsonArray tempArray = doc["hourly"]["temperature_2m"];
-    JsonArray rainArray = doc["hourly"]["rain"];
-    JsonArray snowArray = doc["hourly"]["snowfall"];
-    JsonArray timeArray = doc["hourly"]["time"];
-    
-    if (timeArray.size() > 0) {
-      String firstTime = timeArray[0].as<String>();
-      rtc_forecastStartHour = firstTime.substring(11, 13).toInt();
-      
-      int year = firstTime.substring(0, 4).toInt();
-      int month = firstTime.substring(5, 7).toInt();
-      int day = firstTime.substring(8, 10).toInt();
-      int hour = firstTime.substring(11, 13).toInt();
-      
-      struct tm timeinfo = {0};
-      timeinfo.tm_year = year - 1900;
-      timeinfo.tm_mon = month - 1;
-      timeinfo.tm_mday = day;
-      timeinfo.tm_hour = hour;
-      rtc_weatherFetchTimestamp = mktime(&timeinfo);
-    }
-    
-    for (int i = 0; i < FORECAST_HOURS && i < tempArray.size(); i++) {
-      rtc_forecastTemp[i] = tempArray[i];
-      // Combine rain and snowfall (snowfall in cm, convert to mm equivalent)
-      float rain = rainArray[i] | 0.0f;
-      float snow = snowArray[i] | 0.0f;
-      rtc_forecastRain[i] = rain + (snow * 10.0f);  // 1cm snow ≈ 10mm water
-    }
-    
-    // Parse sunrise and sunset times
-    if (doc["daily"]["sunrise"][0]) {
-      String sunriseStr = doc["daily"]["sunrise"][0].as<String>();
-      String sunriseShort = sunriseStr.substring(11, 16); // Extract HH:MM
-      sunriseShort.toCharArray(rtc_sunriseTimeStr, 6);
-    }
-    if (doc["daily"]["sunset"][0]) {
-      String sunsetStr = doc["daily"]["sunset"][0].as<String>();
-      String sunsetShort = sunsetStr.substring(11, 16); // Extract HH:MM
-      sunsetShort.toCharArray(rtc_sunsetTimeStr, 6);
-    }
-    rtc_weatherDataValid = true;
+  #endif
+  
+  http.end();
+  return !error;
+}
+
+// A forecast that did not fit the wake budget stays due; one that failed
+// counts as tried, see forecastDue().
+void fetchWeatherForecast(const WakeBudget& budget) {
+  ProfileScope profile(PHASE_FETCH_FORECAST);
+  if (WiFi.status() != WL_CONNECTED) {
     #if LOGGING_ENABLED
-      Serial.println("Weather data updated successfully");
-      Serial.print("Sunrise: ");
-      Serial.print(rtc_sunriseTimeStr);
-      Serial.print(" Sunset: ");
-      Serial.println(rtc_sunsetTimeStr);
+      Serial.println("WiFi not connected, skipping weather update");
     #endif
-  } else {
+    return;
+  }
+  if (!budget.allows(FORECAST_MIN_MS, DISPLAY_RESERVE_MS)) {
     #if LOGGING_ENABLED
-      Serial.print("HTTP error: ");
-      Serial.println(httpCode);
+      Serial.println("Out of wake budget, skipping weather update");
     #endif
+    return;
   }
   
-  http.end();
+  #if LOGGING_ENABLED
+    Serial.println("Fetching weather forecast...");
+  #endif
+  uint16_t intoHourS = 0;
+  #if FORECAST_FORMAT == FORECAST_FORMAT_FLATBUFFERS
+    bool ok = fetchForecastFlatBuffer(budget, intoHourS)
+      || (budget.allows(FORECAST_MIN_MS, DISPLAY_RESERVE_MS) && fetchForecastJson(budget, intoHourS));
+  #else
+    bool ok = fetchForecastJson(budget, intoHourS);
+  #endif
+  #if LOGGING_ENABLED
+    if (tlsSessionSaveError()) {
+      Serial.print("TLS session not saved, mbedTLS error ");
+      Serial.println(tlsSessionSaveError());
+    }
+  #endif
+  rtc_state.forecastTriedS = rtc_state.clockMs / 1000;
+  if (!ok) return;
+
+  // Drawn as the next wakes will unpack it, so they see the same content.
+  packForecast(forecast, rtc_state.forecast);
+  unpackForecast(rtc_state.forecast, forecast);
+  rtc_state.forecastFetchedS = rtc_state.forecastTriedS;
+  rtc_state.forecastIntoHourS = intoHourS;
+  rtc_state.weatherDataValid = true;
+  #if LOGGING_ENABLED
+    Serial.println("Weather data updated successfully");
+    Serial.print("Sunrise: ");
+    Serial.print(forecast.sunrise[0]);
+    Serial.print(" Sunset: ");
+    Serial.println(forecast.sunset[0]);
+  #endif
+}
+
+// Fetches every FORECAST_FETCH_S and retries hourly when that fails, while
+// the cache still has hours to spare. Once it gets stale, retries are every
+// FORECAST_STALE_RETRY_S the AP allows, since within a day of the last fetch
+// the cache has no full day left and the forecast disappears from the panel.
+bool forecastDue(uint32_t nowS) {
+  if (rtc_state.bootCount == 1) return true;
+  uint32_t age = nowS - rtc_state.forecastFetchedS;
+  uint32_t sinceTried = nowS - rtc_state.forecastTriedS;
+  if (!rtc_state.weatherDataValid || age >= FORECAST_STALE_S) return sinceTried >= FORECAST_STALE_RETRY_S;
+  return age >= FORECAST_FETCH_S && sinceTried >= FORECAST_RETRY_S;
+}
+
+// Slides the drawn day to the hour of this wake. Hours count from the start
+// of the forecast's first one, so the graph moves on at the full hour.
+void updateForecastWindow() {
+  uint32_t hoursSinceStart = (rtc_state.forecastIntoHourS + rtc_state.clockMs / 1000 - rtc_state.forecastFetchedS) / 3600;
+  forecastShown = forecastWindow(forecast, hoursSinceStart, shownForecast) && rtc_state.weatherDataValid;
 }
 
-void sendToThingSpeak() {
+void recordReadings() {
+  uint32_t timestamp = (rtc_state.clockMs + millis()) / 1000;
+  telemetryRecord(timestamp, tempAir, tempESP, humidity, co2, pressure, batteryVoltage);
+}
+
+// Sends every stored reading in one bulk update, they stay stored on failure.
+void sendToThingSpeak(const WakeBudget& budget) {
+  ProfileScope profile(PHASE_UPLOAD);
   if (WiFi.status() != WL_CONNECTED){
     #if LOGGING_ENABLED
       Serial.println("WiFi not connected, skipping ThingSpeak upload");
     #endif
     return;
   }
+  if (!budget.allows(UPLOAD_MIN_MS)) {
+    #if LOGGING_ENABLED
+      Serial.println("Out of wake budget, readings stay queued");
+    #endif
+    return;
+  }
 
   String url;
-  url.reserve(256);
-  url += "http://api.thingspeak.com/update?api_key=";
-  url += THINGSPEAK_API_KEY;
-  url += "&field1=" + String(tempAir, 2);
-  url += "&field2=" + String(tempESP, 2);
-  url += "&field3=" + String(humidity, 2);
-  url += "&field4=" + String(co2, 0);
-  url += "&field5=" + String(pressure, 0);
-  url += "&field6=" + String(batteryVoltage, 4);
+  url.reserve(96);
+  url += "http://api.thingspeak.com/channels/";
+  url += THINGSPEAK_CHANNEL_ID;
+  url += "/bulk_update.json";
+  String body = telemetryBulkJson(THINGSPEAK_API_KEY, "scd" + String(SCD_MODE) + "," + profilerSummary() + "," + wakeBudgetSummary());
   
   HTTPClient http;
   http.begin(url);
-  http.setTimeout(100); // We don't need response, just send data quickly
-  int code = http.GET();
+  http.addHeader("Content-Type", "application/json");
+  http.setConnectTimeout(budget.timeoutMs(HTTP_TIMEOUT_MS));
+  http.setTimeout(budget.timeoutMs(2000)); // the response says whether the readings can be dropped
+  int code = http.POST(body);
   http.end();
+
+  if (code == 202) telemetryClear();
   
   #if LOGGING_ENABLED
-    if (code > 0) Serial.println("Upload OK");
+    if (code == 202) Serial.println("Upload OK");
     else Serial.println("Upload failed");
   #endif
 }
 
+// ############################### Network task ################################
+
+// Runs WiFi, the forecast download and the upload next to the sensor and
+// display work in setup(), which only waits for the results it needs.
+// `parameter` is the wake's budget, which outlives the task.
+void networkTask(void* parameter) {
+  const WakeBudget& budget = *static_cast<const WakeBudget*>(parameter);
+  connectWiFi();
+  
+  // Without WiFi the forecast stays due for the next attempt, and the radio
+  // goes off instead of idling until the readings are ready.
+  bool online = true;
+  if (largeUpdate) {
+    online = waitForWiFi(budget, DISPLAY_RESERVE_MS);
+    if (online) fetchWeatherForecast(budget);
+  }
+  xEventGroupSetBits(wakeEvents, EVENT_FORECAST_DONE);
+
+  if (uploadDue && online) {
+    xEventGroupWaitBits(wakeEvents, EVENT_READINGS_READY, pdFALSE, pdTRUE, portMAX_DELAY);
+    if (waitForWiFi(budget, 0)) sendToThingSpeak(budget);
+  }
+  WiFi.disconnect(true);
+
+  networkRunning = false;
+  xEventGroupSetBits(wakeEvents, EVENT_UPLOAD_DONE);
+  vTaskDelete(NULL);
+}
+
+void startNetworkTask(const WakeBudget& budget) {
+  networkRunning = true;
+  xTaskCreate(networkTask, "network", 12288, const_cast<WakeBudget*>(&budget), 1, NULL);
+}
+
 // ################################ Display ####################################
 
 void initDisplay1() {
@@ -324,12 +626,76 @@ void initDisplay1() {
   digitalWrite(EPD_PWR_PIN, HIGH);
 }
 
+// GxEPD2 calls this for as long as BUSY is high, seconds per refresh. The
+// network task gets the CPU while it runs; otherwise the chip light-sleeps
+// until the panel pulls BUSY low. Light sleep only wakes on a GPIO level,
+// which is the falling edge here since it starts while BUSY is high. The
+// timer is a fallback, GxEPD2 checks BUSY and its timeout after each call.
+void waitWhilePanelBusy(const void*) {
+  #if LOGGING_ENABLED
+  delay(1);
+  #else
+  if (networkRunning) {
+    delay(1);
+    return;
+  }
+  gpio_wakeup_enable(gpio_num_t(EPD_BUSY_PIN), GPIO_INTR_LOW_LEVEL);
+  esp_sleep_enable_gpio_wakeup();
+  esp_sleep_enable_timer_wakeup(GxEPD2_397_GDEM0397T81::full_refresh_time * 1000ULL);
+  esp_light_sleep_start();
+  esp_sleep_disable_wakeup_source(ESP_SLEEP_WAKEUP_GPIO);
+  gpio_wakeup_disable(gpio_num_t(EPD_BUSY_PIN));
+  #endif
+}
+
 void initDisplay2() {
+  display.epd2.setBusyCallback(waitWhilePanelBusy);
   display.init(115200, false, 2, false);
   display.setRotation(2); // landscape
   display.setTextColor(GxEPD_BLACK);
 }
 
+// Anti-ghosting that no longer fits the wake budget waits for a later wake,
+// the ghosting stays counted. The content is drawn regardless.
+RefreshAction fitRefresh(RefreshAction action, const WakeBudget& budget) {
+  const uint32_t partialMs = GxEPD2_397_GDEM0397T81::partial_refresh_time;
+  uint32_t flashMs = 0;
+  if (action == REFRESH_FULL) flashMs = GxEPD2_397_GDEM0397T81::full_refresh_time;
+  if (action == REFRESH_REGIONS) flashMs = 2 * partialMs;
+  return budget.allows(flashMs + partialMs) ? action : REFRESH_PARTIAL;
+}
+
+// Powers up the panel and clears ghosting as planned before updateDisplay().
+void prepareDisplay(const WakeBudget& budget) {
+  ProfileScope profile(PHASE_INIT_DISPLAY);
+  initDisplay2();
+  refreshAction = fitRefresh(refreshAction, budget);
+  antiGhosting(display, refreshAction);
+
+  #if LOGGING_ENABLED
+    const char* actions[] = {"skip", "partial", "regions", "full"};
+    Serial.print("Refresh: ");
+    Serial.println(actions[refreshAction]);
+  #endif
+}
+
+bool displayShows(float co2Shown) {
+  return displayUpToDate(
+    tempAir,
+    humidity,
+    co2Shown,
+    pressure,
+    shownForecast.sunrise,
+    shownForecast.sunset,
+    shownForecast.temp,
+    shownForecast.rain,
+    FORECAST_HOURS,
+    shownForecast.startHour,
+    forecastShown,
+    moonPhase
+  );
+}
+
 void turnOffDisplay() {
   display.powerOff();
   digitalWrite(EPD_PWR_PIN, LOW);
@@ -342,11 +708,46 @@ void turnOffDisplay() {
   digitalWrite(EPD_TRANSISTOR_PIN, LOW);
 }
 
+// ################################ RTC state ##################################
+
+uint32_t rtcStateCrc() {
+  return esp_rom_crc32_le(0, reinterpret_cast<const uint8_t*>(&rtc_state), offsetof(RtcState, crc));
+}
+
+// Power-up leaves rtc_state zeroed, which fails the check the same way.
+void loadRtcState() {
+  bool valid = rtc_state.version == RTC_STATE_VERSION
+    && rtc_state.size == sizeof(RtcState)
+    && rtc_state.crc == rtcStateCrc();
+  if (!valid) {
+    memset(&rtc_state, 0, sizeof(rtc_state));
+    rtc_state.version = RTC_STATE_VERSION;
+    rtc_state.size = sizeof(RtcState);
+    for (int day = 0; day < FORECAST_DAYS; day++) {
+      rtc_state.forecast.sunrise[day] = NO_CLOCK;
+      rtc_state.forecast.sunset[day] = NO_CLOCK;
+    }
+    refreshStateReset();
+    telemetryReset();
+    wakeBudgetReset();
+    profilerReset();
+    wifiHealthReset();
+    tlsSessionClear();
+  }
+  unpackForecast(rtc_state.forecast, forecast);
+}
+
+// Last thing before deep sleep.
+void sealRtcState() {
+  rtc_state.crc = rtcStateCrc();
+}
+
 // ################################ Setup ####################################
 
 void setup() {
-  rtc_bootCount++;
-  rtc_bootsFromLastForecastFetch++;
+  loadRtcState();
+  rtc_state.bootCount++;
+  profilerBeginCycle();
 
   #if LOGGING_ENABLED
     Serial.begin(115200);
@@ -355,60 +756,104 @@ void setup() {
     }
   #endif
 
-  if(rtc_bootCount == 1) {
+  if(rtc_state.bootCount == 1) {
     delay(10000); // Wait for possible upload
   }
+  WakeBudget budget(WAKE_BUDGET_MS);
 
-  bool largeUpdate = rtc_bootCount == 1 || (rtc_bootsFromLastForecastFetch * UPDATE_INTERVAL_MS) >= WEATHER_UPDATE_INTERVAL_MS;
-
+  // While the AP is backed off the radio stays off, readings queue up and
+  // the forecast waits for the next attempt.
+  bool wifiDue = wifiAttemptDue(rtc_state.clockMs / 1000);
+  largeUpdate = wifiDue && forecastDue(rtc_state.clockMs / 1000);
+  wakeEvents = xEventGroupCreate();
 
   initSensors();
   readSensors();
-  initDisplay1(); 
-  connectWiFi();
-  
-  if (largeUpdate) {
-    waitForWiFi();
-    fetchWeatherForecast();
-    rtc_bootsFromLastForecastFetch = 0;
+  updateForecastWindow();
+  getMoonPhase();
+
+  // Overnight the readings are flat for hours. If the panel would show the
+  // same image, it stays off. CO2 is only known after the conversion: while
+  // it is steady assume it still is and check again then, otherwise start
+  // anti-ghosting now so it overlaps the conversion.
+  refreshAction = planRefresh(largeUpdate || !rtc_state.co2Steady || !displayShows(rtc_state.shownCo2));
+  refreshDue = refreshAction != REFRESH_SKIP;
+  if (refreshDue) initDisplay1();
+
+  // Readings are batched; WiFi is up anyway when the forecast is fetched.
+  uploadDue = largeUpdate || (wifiDue && (
+    telemetryCount() + 1 >= UPLOAD_EVERY_CYCLES
+    || telemetryCount() + 1 >= TELEMETRY_CAPACITY
+    || batteryVoltage < LOW_BATTERY_VOLTAGE));
+
+  // The forecast is needed before drawing, so fetch it during anti-ghosting.
+  if (largeUpdate) startNetworkTask(budget);
+
+  if (refreshDue) prepareDisplay(budget);
+
+  // Otherwise the radio only has to be up by the time there is something to send.
+  if (!largeUpdate && uploadDue) {
+    sleepUntil(scdReadyAtMs - (canFastConnect() ? WIFI_FAST_CONNECT_LEAD_MS : WIFI_CONNECT_LEAD_MS));
+    startNetworkTask(budget);
+  } else if (!largeUpdate) {
+    xEventGroupSetBits(wakeEvents, EVENT_FORECAST_DONE | EVENT_UPLOAD_DONE); // radio stays off
   }
 
-  initDisplay2();
+  // Light sleep through the rest of the conversion, unless the network task
+  // needs the CPU; finishSensorSCD() then waits with delay().
+  if (!networkRunning) sleepUntil(scdReadyAtMs);
+  finishSensorSCD(budget);
+  recordReadings();
+  xEventGroupSetBits(wakeEvents, EVENT_READINGS_READY);
+  xEventGroupWaitBits(wakeEvents, EVENT_FORECAST_DONE, pdFALSE, pdTRUE, portMAX_DELAY);
 
-  if (largeUpdate) {
-    largeAntiGhosting(display);
-  } else {
-    smallAntiGhosting(display);
+  updateForecastWindow(); // the forecast may have moved on
+  getMoonPhase();
+  rtc_state.co2Steady = lroundf(co2) == rtc_state.shownCo2;
+  if (!refreshDue && !displayShows(co2)) {
+    refreshAction = planRefresh(true);
+    refreshDue = true;
+    initDisplay1();
+    prepareDisplay(budget);
   }
 
-  getMoonPhase();
-  updateDisplay(
-    display,
-    tempAir,
-    humidity,
-    co2,
-    pressure,
-    rtc_sunriseTimeStr,
-    rtc_sunsetTimeStr,
-    rtc_forecastTemp,
-    rtc_forecastRain,
-    FORECAST_HOURS,
-    rtc_forecastStartHour,
-    rtc_weatherDataValid,
-    moonPhase
-  );
+  if (refreshDue) {
+    ProfileScope profile(PHASE_UPDATE_DISPLAY);
+    updateDisplay(
+      display,
+      tempAir,
+      humidity,
+      co2,
+      pressure,
+      shownForecast.sunrise,
+      shownForecast.sunset,
+      shownForecast.temp,
+      shownForecast.rain,
+      FORECAST_HOURS,
+      shownForecast.startHour,
+      forecastShown,
+      moonPhase
+    );
+    rtc_state.shownCo2 = lroundf(co2);
+  }
   
-  waitForWiFi();
-  sendToThingSpeak();
+  // The upload went out while the panel was refreshing.
+  xEventGroupWaitBits(wakeEvents, EVENT_UPLOAD_DONE, pdFALSE, pdTRUE, portMAX_DELAY);
+  vEventGroupDelete(wakeEvents);
 
-  WiFi.disconnect(true);
+  if (refreshDue) turnOffDisplay();
 
-  turnOffDisplay();
+  profilerEndCycle();
+  budget.finish();
 
   unsigned long sleepTimeUs = max((UPDATE_INTERVAL_MS - millis()) * 1000ULL, 1000ULL);
+  rtc_state.clockMs += millis() + sleepTimeUs / 1000;
+  sealRtcState();
 
 
   #if LOGGING_ENABLED
+    Serial.println(profilerSummary());
+    Serial.println(wakeBudgetSummary());
     Serial.println("faking deep sleep for debug");
     delay(10);
     Serial.end();
@@ -0,0 +1,80 @@
+#include "profiler.h"
+
+static const char* const PHASE_NAMES[PHASE_COUNT] = {
+  "init", "bmp", "aht", "scd", "wifi", "fcst", "epdi", "epdu", "up", "awake"
+};
+
+RTC_DATA_ATTR static uint16_t rtc_profileRing[PROFILE_HISTORY][PHASE_COUNT];
+RTC_DATA_ATTR static uint8_t rtc_profileHead = 0;
+RTC_DATA_ATTR static uint8_t rtc_profileCount = 0;
+
+static unsigned long currentCycle[PHASE_COUNT];
+
+ProfileScope::ProfileScope(ProfilePhase phase) : _phase(phase), _start(millis()) {}
+
+ProfileScope::~ProfileScope() {
+  profilerAdd(_phase, millis() - _start);
+}
+
+void profilerBeginCycle() {
+  for (int i = 0; i < PHASE_COUNT; i++) currentCycle[i] = 0;
+}
+
+void profilerAdd(ProfilePhase phase, unsigned long ms) {
+  currentCycle[phase] += ms;
+}
+
+void profilerEndCycle() {
+  currentCycle[PHASE_AWAKE] = millis();
+  for (int i = 0; i < PHASE_COUNT; i++) {
+    rtc_profileRing[rtc_profileHead][i] = static_cast<uint16_t>(min(currentCycle[i], 0xFFFFUL));
+  }
+  rtc_profileHead = (rtc_profileHead + 1) % PROFILE_HISTORY;
+  if (rtc_profileCount < PROFILE_HISTORY) rtc_profileCount++;
+}
+
+uint8_t profilerCycles() {
+  return rtc_profileCount;
+}
+
+uint16_t profilerLast(ProfilePhase phase) {
+  if (rtc_profileCount == 0) return 0;
+  return rtc_profileRing[(rtc_profileHead + PROFILE_HISTORY - 1) % PROFILE_HISTORY][phase];
+}
+
+ProfileRollup profilerRollup(ProfilePhase phase) {
+  ProfileRollup rollup = {0, 0, 0};
+  if (rtc_profileCount == 0) return rollup;
+
+  uint32_t sum = 0;
+  rollup.minMs = 0xFFFF;
+  for (int i = 0; i < rtc_profileCount; i++) {
+    uint16_t ms = rtc_profileRing[i][phase];
+    sum += ms;
+    rollup.minMs = min(rollup.minMs, ms);
+    rollup.maxMs = max(rollup.maxMs, ms);
+  }
+  rollup.avgMs = sum / rtc_profileCount;
+  return rollup;
+}
+
+const char* profilerPhaseName(ProfilePhase phase) {
+  return PHASE_NAMES[phase];
+}
+
+String profilerSummary() {
+  String summary;
+  summary.reserve(200);
+  for (int i = 0; i < PHASE_COUNT; i++) {
+    ProfileRollup rollup = profilerRollup(static_cast<ProfilePhase>(i));
+    if (i > 0) summary += ",";
+    summary += PHASE_NAMES[i];
+    summary += ":" + String(rollup.minMs) + "/" + String(rollup.avgMs) + "/" + String(rollup.maxMs);
+  }
+  return summary;
+}
+
+void profilerReset() {
+  rtc_profileHead = 0;
+  rtc_profileCount = 0;
+}
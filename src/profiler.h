@@ -0,0 +1,61 @@
+#pragma once
+#include <Arduino.h>
+
+/**
+ * Wake cycle profiler
+ *
+ * Phases accumulate milliseconds while a ProfileScope is alive. The totals
+ * of each wake are committed to an RTC ring of the last PROFILE_HISTORY
+ * cycles, from which min/avg/max rollups are uploaded with the readings.
+**/
+
+#define PROFILE_HISTORY 12
+
+enum ProfilePhase : uint8_t {
+  PHASE_INIT_SENSORS,
+  PHASE_READ_BMP,
+  PHASE_READ_AHT,
+  PHASE_READ_SCD,       // start of the CO2 conversion to the reading
+  PHASE_WIFI,           // connectWiFi + waitForWiFi
+  PHASE_FETCH_FORECAST,
+  PHASE_INIT_DISPLAY,   // initDisplay2 + anti-ghosting
+  PHASE_UPDATE_DISPLAY,
+  PHASE_UPLOAD,
+  PHASE_AWAKE,          // whole wake, committed at the end
+  PHASE_COUNT
+};
+
+struct ProfileRollup {
+  uint16_t minMs;
+  uint16_t avgMs;
+  uint16_t maxMs;
+};
+
+class ProfileScope {
+  public:
+    explicit ProfileScope(ProfilePhase phase);
+    ~ProfileScope();
+  private:
+    ProfilePhase _phase;
+    unsigned long _start;
+};
+
+void profilerBeginCycle();
+
+void profilerAdd(ProfilePhase phase, unsigned long ms);
+
+void profilerEndCycle();
+
+uint8_t profilerCycles();
+
+uint16_t profilerLast(ProfilePhase phase);
+
+ProfileRollup profilerRollup(ProfilePhase phase);
+
+const char* profilerPhaseName(ProfilePhase phase);
+
+// "name:min/avg/max,..." for all phases, suitable for a ThingSpeak status field.
+String profilerSummary();
+
+// Drops the history.
+void profilerReset();
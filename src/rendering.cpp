@@ -1,27 +1,227 @@
 #include "rendering.h"
-#include "icons/temp.icon.h"
-#include "icons/humidity.icon.h"
-#include "icons/pressure.icon.h"
-#include "icons/sunrise.icon.h"
-#include "icons/sunset.icon.h"
-#include "icons/co2.icon.h"
-#include "icons/moon.icon.h"
+#include "framebuffer.h"
+#include "glyph_atlas.h"
+#include "icons.h"
+
+// ############################## Dirty regions ################################
+
+/*
+ * The screen is split into regions whose content is hashed from the values
+ * drawn there. Hashes of what the panel shows are kept in RTC memory, and
+ * updateDisplay() only refreshes the bounding box of the regions that
+ * changed. A zero hash means unknown, e.g. after power-up or after
+ * anti-ghosting wiped the area.
+*/
+
+enum Region {
+	REGION_HOURS,
+	REGION_GRAPH,
+	REGION_RAIN,
+	REGION_CELL_FIRST,
+	REGION_COUNT = REGION_CELL_FIRST + 7
+};
+
+struct Rect {
+	int16_t x, y, w, h;
+};
+
+RTC_DATA_ATTR static uint32_t rtc_regionHashes[REGION_COUNT];
+
+const int WEATHER_Y = 8;
+const int ICON_COUNT = 7;
+const int ICON_SIZE = 56;
+const int MOON_BOX = 64;    // drawn like the 64 px icons
+const int MOON_DIAMETER = 55;
+const int FORECAST_MAX_POINTS = 48;
+const int CURVE_HALF_WIDTH = 2;
+
+static int tempGraphY() { return WEATHER_Y + 28; }
+static int graphHeight(DisplayType& display) { return (display.height() * 50) / 100; }
+static int rainY(DisplayType& display) { return tempGraphY() + graphHeight(display); }
+static int rainHeight(DisplayType& display) { return std::max(12, graphHeight(display) / 3); }
+static int bottomY(DisplayType& display) { return display.height() - std::max(64, display.height() / 5) - 16; }
+static int iconGap(DisplayType& display) { return (display.width() - ICON_COUNT * ICON_SIZE) / (ICON_COUNT + 1); }
+
+static Rect regionRect(DisplayType& display, int region) {
+	int screenW = display.width();
+	switch (region) {
+		case REGION_HOURS: return Rect{0, 0, int16_t(screenW), int16_t(tempGraphY())};
+		case REGION_GRAPH: return Rect{0, int16_t(tempGraphY()), int16_t(screenW), int16_t(graphHeight(display))};
+		case REGION_RAIN: return Rect{0, int16_t(rainY(display)), int16_t(screenW), int16_t(rainHeight(display))};
+	}
+	// Icons start 4 px above bottomY, values may spill into the next cell's margin.
+	int pitch = ICON_SIZE + iconGap(display);
+	int center = iconGap(display) + (region - REGION_CELL_FIRST) * pitch + ICON_SIZE / 2;
+	int top = bottomY(display) - 4;
+	return Rect{int16_t(center - pitch / 2), int16_t(top), int16_t(pitch), int16_t(display.height() - top)};
+}
+
+static uint32_t hashBytes(uint32_t hash, const void* data, size_t size) {
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	for (size_t i = 0; i < size; i++) {
+		hash = (hash ^ bytes[i]) * 16777619u; // FNV-1a
+	}
+	return hash;
+}
+
+static uint32_t hashString(const String& text, int icon) {
+	uint32_t hash = hashBytes(2166136261u, text.c_str(), text.length());
+	hash = hashBytes(hash, &icon, sizeof(icon));
+	return hash ? hash : 1;
+}
+
+// Bounding box of the flagged regions, x widened to the controller's 8 px
+// RAM granularity so no column outside it is touched. w is 0 if none is.
+static Rect regionsBox(DisplayType& display, const bool* flagged) {
+	int x1 = display.width(), y1 = display.height(), x2 = 0, y2 = 0;
+	for (int i = 0; i < REGION_COUNT; i++) {
+		if (!flagged[i]) continue;
+		Rect r = regionRect(display, i);
+		x1 = std::min<int>(x1, r.x);
+		y1 = std::min<int>(y1, r.y);
+		x2 = std::max<int>(x2, r.x + r.w);
+		y2 = std::max<int>(y2, r.y + r.h);
+	}
+	if (x1 >= x2) return Rect{0, 0, 0, 0};
+	x1 = std::max(0, x1 & ~7);
+	x2 = std::min<int>(display.width(), (x2 + 7) & ~7);
+	return Rect{int16_t(x1), int16_t(y1), int16_t(x2 - x1), int16_t(y2 - y1)};
+}
+
+static bool overlaps(const Rect& a, const Rect& b) {
+	return a.x < b.x + b.w && b.x < a.x + a.w && a.y < b.y + b.h && b.y < a.y + a.h;
+}
+
+// ############################## Refresh policy ###############################
+
+/*
+ * Every partial refresh leaves a faint ghost of the pixels it flips, and the
+ * ghosts add up. To know how much flipped, each region is split into tiles
+ * whose ink and hash are kept in RTC memory. The previous frame is not kept,
+ * so a changed tile counts as max(old ink, new ink) flipped pixels. The flips
+ * are summed per region, relative to its area.
+ *
+ * planRefresh() spends this budget. A region whose ghosting reaches
+ * REGION_GHOST_LIMIT is flashed black and white on its own before drawing.
+ * After FULL_REFRESH_PARTIALS partial refreshes, or when the panel content is
+ * unknown after power-up, the whole panel gets a full refresh instead.
+*/
+
+const int TILE_SIZE = 32;
+const int TILE_CAPACITY = 480;              // tiles of all regions in either orientation
+const uint16_t REGION_GHOST_LIMIT = 256;    // flipped pixels, 256 = the region's area
+const uint16_t FULL_REFRESH_PARTIALS = 72;  // 6 hours of refreshes every 5 minutes
+
+struct Tile {
+	uint8_t ink;   // black pixels / 4, rounded up
+	uint8_t hash;  // 0 for a blank tile
+};
+
+RTC_DATA_ATTR static Tile rtc_tiles[TILE_CAPACITY];
+RTC_DATA_ATTR static uint16_t rtc_regionGhosting[REGION_COUNT];
+RTC_DATA_ATTR static uint16_t rtc_partialRefreshes = 0;
+RTC_DATA_ATTR static bool rtc_panelKnown = false;
+
+static int tileCount(const Rect& r) {
+	return ((r.w + TILE_SIZE - 1) / TILE_SIZE) * ((r.h + TILE_SIZE - 1) / TILE_SIZE);
+}
+
+// Index of the region's first tile in rtc_tiles.
+static int firstTile(DisplayType& display, int region) {
+	int tile = 0;
+	for (int i = 0; i < region; i++) tile += tileCount(regionRect(display, i));
+	return tile;
+}
+
+// The panel is white in `box`: what the regions there show is unknown to
+// the hashes, and their tiles there are blank and free of ghosting.
+static void wipeRegions(DisplayType& display, const Rect& box) {
+	int tile = 0;
+	for (int i = 0; i < REGION_COUNT; i++) {
+		Rect r = regionRect(display, i);
+		if (!overlaps(r, box)) {
+			tile += tileCount(r);
+			continue;
+		}
+		rtc_regionHashes[i] = 0;
+		rtc_regionGhosting[i] = 0;
+		for (int ty = r.y; ty < r.y + r.h; ty += TILE_SIZE) {
+			for (int tx = r.x; tx < r.x + r.w; tx += TILE_SIZE, tile++) {
+				if (tile < TILE_CAPACITY && overlaps(Rect{int16_t(tx), int16_t(ty), TILE_SIZE, TILE_SIZE}, box)) {
+					rtc_tiles[tile] = Tile{0, 0};
+				}
+			}
+		}
+	}
+}
+
+// Compares the region's tiles, drawn into the window, with the RTC copy and
+// adds what flipped to its ghosting.
+static void addGhosting(DisplayType& display, const FrameBuffer& fb, int region) {
+	Rect r = regionRect(display, region);
+	int tile = firstTile(display, region);
+	uint32_t flipped = 0;
+	for (int ty = r.y; ty < r.y + r.h; ty += TILE_SIZE) {
+		for (int tx = r.x; tx < r.x + r.w && tile < TILE_CAPACITY; tx += TILE_SIZE, tile++) {
+			uint32_t hash;
+			uint32_t ink = boxInk(fb, tx, std::min(tx + TILE_SIZE, r.x + r.w) - 1, ty, std::min(ty + TILE_SIZE, r.y + r.h) - 1, &hash);
+			uint8_t folded = (hash ^ (hash >> 8) ^ (hash >> 16) ^ (hash >> 24)) | 1;
+			Tile now{uint8_t(std::min<uint32_t>((ink + 3) / 4, 255)), ink ? folded : uint8_t(0)};
+			Tile& shown = rtc_tiles[tile];
+			if (now.ink == shown.ink && now.hash == shown.hash) continue;
+			flipped += 4 * std::max(now.ink, shown.ink);
+			shown = now;
+		}
+	}
+	uint32_t ghosting = rtc_regionGhosting[region] + flipped * 256 / (r.w * r.h);
+	rtc_regionGhosting[region] = std::min<uint32_t>(ghosting, UINT16_MAX);
+}
+
+RefreshAction planRefresh(bool contentChanged) {
+	if (!contentChanged && rtc_panelKnown) return REFRESH_SKIP;
+	if (!rtc_panelKnown || rtc_partialRefreshes >= FULL_REFRESH_PARTIALS) return REFRESH_FULL;
+	for (int i = 0; i < REGION_COUNT; i++) {
+		if (rtc_regionGhosting[i] >= REGION_GHOST_LIMIT) return REFRESH_REGIONS;
+	}
+	return REFRESH_PARTIAL;
+}
 
 void largeAntiGhosting(DisplayType& display) {
-  display.fillScreen(GxEPD_WHITE);
-  display.nextPage();
-  delay(5);
+	display.fillScreen(GxEPD_WHITE);
+	display.nextPage();
+	delay(5);
+	wipeRegions(display, Rect{0, 0, int16_t(display.width()), int16_t(display.height())});
+	rtc_partialRefreshes = 0;
+	rtc_panelKnown = true;
 }
 
-void smallAntiGhosting(DisplayType& display) {
-  display.setPartialWindow(0, GxEPD2_397_GDEM0397T81::HEIGHT - 50, GxEPD2_397_GDEM0397T81::WIDTH_VISIBLE, 30);
-  display.fillScreen(GxEPD_BLACK);
-  display.nextPage();
-  delay(5);
-  display.setPartialWindow(0, GxEPD2_397_GDEM0397T81::HEIGHT - 50, GxEPD2_397_GDEM0397T81::WIDTH_VISIBLE, 30);
-  display.fillScreen(GxEPD_WHITE);
-  display.nextPage();
-  delay(5);
+void refreshStateReset() {
+	memset(rtc_regionHashes, 0, sizeof(rtc_regionHashes));
+	memset(rtc_tiles, 0, sizeof(rtc_tiles));
+	memset(rtc_regionGhosting, 0, sizeof(rtc_regionGhosting));
+	rtc_partialRefreshes = 0;
+	rtc_panelKnown = false;
+}
+
+// One black and one white flash over the regions that used up their budget.
+static void regionAntiGhosting(DisplayType& display) {
+	bool flagged[REGION_COUNT];
+	for (int i = 0; i < REGION_COUNT; i++) flagged[i] = rtc_regionGhosting[i] >= REGION_GHOST_LIMIT;
+	Rect box = regionsBox(display, flagged);
+	if (box.w == 0) return;
+	for (uint16_t color : {GxEPD_BLACK, GxEPD_WHITE}) {
+		display.setPartialWindow(box.x, box.y, box.w, box.h);
+		display.fillScreen(color);
+		display.nextPage();
+		delay(5);
+	}
+	wipeRegions(display, box);
+	rtc_partialRefreshes += 2;
+}
+
+void antiGhosting(DisplayType& display, RefreshAction action) {
+	if (action == REFRESH_FULL) largeAntiGhosting(display);
+	else if (action == REFRESH_REGIONS) regionAntiGhosting(display);
 }
 
 inline void drawDashedHLine(DisplayType& display, int x1, int x2, int y, int onLen = 3, int offLen = 3) {
@@ -51,111 +251,161 @@ const uint8_t ditherPatterns[8][4] = {
 	{0b0000, 0b0000, 0b0000, 0b0000},
 };
 
-inline bool shouldDrawPixel(int x, int y, int ditherLevel) {
-	if (ditherLevel >= 8) return false;
-	if (ditherLevel < 0) ditherLevel = 0;
-	int px = x % 4;
-	int py = y % 4;
-	return (ditherPatterns[ditherLevel][py] >> (3 - px)) & 1;
-}
+/*
+ * Data to screen mapping. The ESP32-C3 has no FPU, so the soft-float math
+ * is done once per data point and everything per pixel is integer. The
+ * range maps CURVE_HALF_WIDTH inside the graph's rows, so the thick curve
+ * and the grid stay within REGION_GRAPH.
+*/
+struct GraphScale {
+	float minVal;
+	float range;
+	int h;
+	int bottom;
+};
 
-void drawForecastGraph(DisplayType& display, int x, int y, int w, int h, const float* data, int dataSize, float minVal, float maxVal) {
+static GraphScale graphScale(int y, int h, float minVal, float maxVal) {
 	float range = maxVal - minVal;
 	if (range <= 0.001f) range = 1.0f;
+	return GraphScale{minVal, range, h - 2 * CURVE_HALF_WIDTH - 1, y + h - 1 - CURVE_HALF_WIDTH};
+}
 
-	int zeroY = y + h - static_cast<int>(((0.0f - minVal) / range) * h);
+static int toScreenY(const GraphScale& scale, float value) {
+	return scale.bottom - static_cast<int>(((value - scale.minVal) / scale.range) * scale.h);
+}
+
+// Screen position of each data point; returns how many fit the table.
+static int graphPoints(const GraphScale& scale, int x, int w, const float* data, int dataSize, int16_t* xs, int16_t* ys) {
+	int points = std::min(dataSize, FORECAST_MAX_POINTS);
+	for (int i = 0; i < points; i++) {
+		xs[i] = x + i * w / dataSize;
+		ys[i] = toScreenY(scale, data[i]);
+	}
+	return points;
+}
+
+/*
+ * The fade under (or, below zero, above) the curve. Every column gets the
+ * same stack of dither rows, offset by the curve's Y there, so neighbouring
+ * columns at the same Y are filled together: one span per row of the stack.
+ * Between points the curve's Y is stepped in Q16, truncated towards the
+ * earlier point.
+*/
+static void drawTrail(FrameBuffer& fb, const int16_t* xs, const int16_t* ys, const float* data, int points, int y, int h, int zeroY) {
 	bool zeroInRange = (zeroY >= y && zeroY <= y + h);
 
 	const int fadeDepth = 24;
 	const int fadeSteps = 8;
-	
-	for (int i = 0; i < dataSize - 1; i++) {
-		int x1 = x + i * w / dataSize;
-		int x2 = x + (i + 1) * w / dataSize;
-		int lineY = y + h - static_cast<int>(((data[i] - minVal) / range) * h);
-		
+
+	// The rows below a curve at Y, for each Y % 4; the first 3 stay clear.
+	uint8_t stacksDown[4][fadeDepth + 1];
+	for (int phase = 0; phase < 4; phase++) {
+		for (int dist = 0; dist <= fadeDepth; dist++) {
+			int ditherLevel = (dist * fadeSteps) / fadeDepth;
+			stacksDown[phase][dist] = dist < 3 || ditherLevel >= fadeSteps ? 0 : ditherPatterns[ditherLevel][(phase + dist) % 4];
+		}
+	}
+	// The same upwards, for temperatures below zero.
+	uint8_t stacksUp[4][fadeDepth + 1];
+	for (int phase = 0; phase < 4; phase++) {
+		for (int dist = 0; dist <= fadeDepth; dist++) {
+			int ditherLevel = (dist * fadeSteps) / fadeDepth;
+			stacksUp[phase][dist] = dist < 3 || ditherLevel >= fadeSteps ? 0 : ditherPatterns[ditherLevel][(phase + 4 - dist % 4) % 4];
+		}
+	}
+
+	for (int i = 0; i < points - 1; i++) {
+		int x1 = xs[i];
+		int x2 = xs[i + 1];
+		int lineY = ys[i];
+		int delta = ys[i + 1] - lineY;
+		if (x2 <= x1) continue;
+		// Rounded up so exact multiples land on the same pixel as t * delta.
+		int32_t stepQ16 = ((int32_t(std::abs(delta)) << 16) + (x2 - x1) - 1) / (x2 - x1);
+
 		bool aboveZero = data[i] >= 0;
-		
-		for (int px = x1; px < x2; px++) {
-			float t = static_cast<float>(px - x1) / static_cast<float>(x2 - x1);
-			int nextLineY = y + h - static_cast<int>(((data[i + 1] - minVal) / range) * h);
-			int currentY = lineY + static_cast<int>(t * (nextLineY - lineY));
-			
-			currentY = std::max(y, std::min(y + h - 1, currentY));
-			
+		int trailLimit = aboveZero
+			? (zeroInRange ? std::min(zeroY, y + h - 1) : y + h - 1)
+			: (zeroInRange ? std::max(zeroY, y) : y);
+
+		int runX = x1;
+		int runY = 0;
+		int32_t offsetQ16 = 0;
+		for (int px = x1; px <= x2; px++, offsetQ16 += stepQ16) {
+			int currentY = runY;
+			if (px < x2) {
+				int offset = offsetQ16 >> 16;
+				currentY = delta < 0 ? lineY - offset : lineY + offset;
+				currentY = std::max(y, std::min(y + h - 1, currentY));
+				if (px == x1) runY = currentY;
+			}
+			if (px < x2 && currentY == runY) continue;
+
+			// Columns runX .. px - 1 share the curve at runY.
 			if (aboveZero) {
-				int trailEnd = zeroInRange ? std::min(zeroY, y + h - 1) : y + h - 1;
-				trailEnd = std::min(trailEnd, currentY + fadeDepth);
-				
-				for (int py = currentY + 3; py <= trailEnd; py++) {
-					int dist = py - currentY;
-					int ditherLevel = (dist * fadeSteps) / fadeDepth;
-					if (shouldDrawPixel(px, py, ditherLevel)) {
-						display.drawPixel(px, py, GxEPD_BLACK);
-					}
-				}
+				int rows = std::min(trailLimit, runY + fadeDepth) - runY - 2;
+				fillPatternRows(fb, runX, px - 1, runY + 3, 1, &stacksDown[runY % 4][3], rows);
 			} else {
-				int trailEnd = zeroInRange ? std::max(zeroY, y) : y;
-				trailEnd = std::max(trailEnd, currentY - fadeDepth);
-				
-				for (int py = currentY - 3; py >= trailEnd; py--) {
-					int dist = currentY - py;
-					int ditherLevel = (dist * fadeSteps) / fadeDepth;
-					if (shouldDrawPixel(px, py, ditherLevel)) {
-						display.drawPixel(px, py, GxEPD_BLACK);
-					}
-				}
+				int rows = runY - std::max(trailLimit, runY - fadeDepth) - 2;
+				fillPatternRows(fb, runX, px - 1, runY - 3, -1, &stacksUp[runY % 4][3], rows);
 			}
+			runX = px;
+			runY = currentY;
 		}
 	}
+}
+
+void drawForecastTrail(DisplayType& display, int x, int y, int w, int h, const float* data, int dataSize, float minVal, float maxVal) {
+	GraphScale scale = graphScale(y, h, minVal, maxVal);
+	int16_t xs[FORECAST_MAX_POINTS], ys[FORECAST_MAX_POINTS];
+	int points = graphPoints(scale, x, w, data, dataSize, xs, ys);
+	FrameBuffer fb = frameBuffer(display);
+	drawTrail(fb, xs, ys, data, points, y, h, toScreenY(scale, 0.0f));
+}
+
+void drawForecastGraph(DisplayType& display, int x, int y, int w, int h, const float* data, int dataSize, float minVal, float maxVal) {
+	GraphScale scale = graphScale(y, h, minVal, maxVal);
+	int16_t xs[FORECAST_MAX_POINTS], ys[FORECAST_MAX_POINTS];
+	int points = graphPoints(scale, x, w, data, dataSize, xs, ys);
+	FrameBuffer fb = frameBuffer(display);
+
+	drawTrail(fb, xs, ys, data, points, y, h, toScreenY(scale, 0.0f));
 
 	int firstLine = static_cast<int>(floor(minVal / 10.0f)) * 10;
 	for (int t = firstLine; t <= static_cast<int>(ceil(maxVal)); t += 10) {
-		float val = static_cast<float>(t);
-		int yy = y + h - static_cast<int>(((val - minVal) / range) * h);
-		if (yy < y || yy > y + h) continue;
-		if (t == 0) {
-			display.drawLine(x + 1, yy - 1, x + w - 2, yy - 1, GxEPD_BLACK);
-			display.drawLine(x + 1, yy, x + w - 2, yy, GxEPD_BLACK);
-			display.drawLine(x + 1, yy + 1, x + w - 2, yy + 1, GxEPD_BLACK);
-		} else {
-			display.drawLine(x + 1, yy, x + w - 2, yy, GxEPD_BLACK);
-		}
+		int yy = toScreenY(scale, static_cast<float>(t));
+		if (yy < scale.bottom - scale.h || yy > scale.bottom) continue;
+		int thickness = t == 0 ? 1 : 0;
+		fillBox(fb, x + 1, x + w - 2, yy - thickness, yy + thickness);
 	}
 
-	for (int i = 1; i < dataSize; i++) {
-		int x1 = x + (i - 1) * w / dataSize;
-		int y1 = y + h - static_cast<int>(((data[i - 1] - minVal) / range) * h);
-		int x2 = x + i * w / dataSize;
-		int y2 = y + h - static_cast<int>(((data[i] - minVal) / range) * h);
-		for (int off = -2; off <= 2; off++) {
-			display.drawLine(x1, y1 + off, x2, y2 + off, GxEPD_BLACK);
-		}
-	}
+	fillThickPolyline(fb, xs, ys, points, CURVE_HALF_WIDTH);
 }
 
 void drawRainColumns(DisplayType& display, int x, int y, int w, int h, const float* data, int dataSize, float maxVal) {
 	int colWidth = std::max(1, w / dataSize);
+	if (colWidth < 2) return;
+	FrameBuffer fb = frameBuffer(display);
+	float pixelsPerUnit = h / maxVal;
 	for (int i = 0; i < dataSize; i++) {
 		float v = data[i];
 		if (v <= 0) continue;
-		int colHeight = static_cast<int>((v / maxVal) * h);
+		int colHeight = static_cast<int>(v * pixelsPerUnit);
 		if (colHeight < 1) colHeight = 1;
 		int x1 = x + i * colWidth;
 		int y1 = y + h - colHeight;
-		display.fillRect(x1, y1, colWidth - 1, colHeight, GxEPD_BLACK);
+		fillBox(fb, x1, x1 + colWidth - 2, y1, y + h - 1);
 	}
 }
 
 void drawWeatherForecast(DisplayType& display, const float* forecastTemp, const float* forecastRain, int forecastHours, int forecastStartHour, const String& sunriseTime, const String& sunsetTime, bool weatherDataValid) {
 	if (!weatherDataValid) return;
 	int screenW = display.width();
-	int screenH = display.height();
 
-	int weatherY = 8;
+	int weatherY = WEATHER_Y;
 	int graphX = 4;
 	int graphWidth = screenW - 8;
-	int graphHeight = (screenH * 50) / 100;
+	int graphHeight = ::graphHeight(display);
 
 	float minTemp = forecastTemp[0], maxTemp = forecastTemp[0];
 	float maxRain = 0;
@@ -168,13 +418,13 @@ void drawWeatherForecast(DisplayType& display, const float* forecastTemp, const
 	maxTemp = ceil(maxTemp);
 	if (minTemp == maxTemp) { minTemp -= 1; maxTemp += 1; }
 
-	int tempGraphY = weatherY + 28;
-	int rainHeight = std::max(12, graphHeight / 3);
-	int rainY = tempGraphY + graphHeight;
+	int tempGraphY = ::tempGraphY();
+	int rainHeight = ::rainHeight(display);
+	int rainY = ::rainY(display);
 	
 	drawForecastGraph(display, graphX, tempGraphY, graphWidth, graphHeight, forecastTemp, forecastHours, minTemp, maxTemp);
 
-	display.setFont(&FreeSans12pt7b);
+	FrameBuffer fb = frameBuffer(display);
 	int hourY = weatherY + 18;
 	int lineEndY = rainY + rainHeight;
 	
@@ -185,39 +435,168 @@ void drawWeatherForecast(DisplayType& display, const float* forecastTemp, const
 		
 		String hlabel = String(hour);
 		int16_t tbx, tby; uint16_t tbw, tbh;
-		display.getTextBounds(hlabel, xx, hourY, &tbx, &tby, &tbw, &tbh);
-		display.setCursor(xx - tbw / 2, hourY);
-		display.print(hlabel);
+		textBounds(FreeSans12pt7bAtlas, hlabel, xx, hourY, &tbx, &tby, &tbw, &tbh);
+		drawText(fb, FreeSans12pt7bAtlas, xx - tbw / 2, hourY, hlabel);
 		
-		if (hour == 0 || hour == 12) {
-			display.drawLine(xx - 1, tempGraphY + 1, xx + 1, lineEndY - 1, GxEPD_BLACK);
-			display.drawLine(xx, tempGraphY + 1, xx, lineEndY - 1, GxEPD_BLACK);
-			display.drawLine(xx + 1, tempGraphY + 1, xx + 1, lineEndY - 1, GxEPD_BLACK);
-		} else {
-			display.drawLine(xx, tempGraphY + 1, xx, lineEndY - 1, GxEPD_BLACK);
-		}
+		int thickness = hour == 0 || hour == 12 ? 1 : 0;
+		fillBox(fb, xx - thickness, xx + thickness, tempGraphY + 1, lineEndY - 1);
 	}
 
-	display.setFont(&FreeSansBold18pt7b);
-	int charWidth = 19;
-	
+	// Right aligned on the advance widths, so no digit needs guessing.
 	String maxTempStr = String(static_cast<int>(maxTemp));
-	int maxLabelX = graphX + graphWidth - (maxTempStr.length() * charWidth);
-	display.setCursor(maxLabelX, tempGraphY + 32);
-	display.print(maxTempStr);
+	int maxLabelX = graphX + graphWidth - textAdvance(FreeSansBold18pt7bAtlas, maxTempStr);
+	drawText(fb, FreeSansBold18pt7bAtlas, maxLabelX, tempGraphY + 32, maxTempStr);
 	
 	String minTempStr = String(static_cast<int>(minTemp));
-	int minLabelX = graphX + graphWidth - (minTempStr.length() * charWidth);
-	display.setCursor(minLabelX, tempGraphY + graphHeight - 14);
-	display.print(minTempStr);
+	int minLabelX = graphX + graphWidth - textAdvance(FreeSansBold18pt7bAtlas, minTempStr);
+	drawText(fb, FreeSansBold18pt7bAtlas, minLabelX, tempGraphY + graphHeight - 14, minTempStr);
 
 	drawRainColumns(display, graphX, rainY, graphWidth, rainHeight, forecastRain, forecastHours, max(maxRain, 1.0f));
 
-	display.setFont(&FreeSans18pt7b);
 	String rainStr = String(static_cast<int>(ceil(maxRain)));
-	int rainLabelX = graphX + graphWidth - (rainStr.length() * charWidth);
-	display.setCursor(rainLabelX, rainY + 40);
-	display.print(rainStr);
+	int rainLabelX = graphX + graphWidth - textAdvance(FreeSans18pt7bAtlas, rainStr);
+	drawText(fb, FreeSans18pt7bAtlas, rainLabelX, rainY + 40, rainStr);
+}
+
+static String cellValue(int cell, float tempAir, float humidity, float co2, float pressure, const String& sunriseTime, const String& sunsetTime) {
+	switch (cell) {
+		case 0: return String(tempAir, 1) + "C";
+		case 1: return String(humidity, 0) + "%";
+		case 2: return sunriseTime;
+		case 3: return " ";
+		case 4: return sunsetTime;
+		case 5: return String(co2,0);
+		case 6: return String(pressure,0);
+	}
+	return String();
+}
+
+static uint32_t isqrt(uint32_t n) {
+	uint32_t root = 0;
+	for (uint32_t bit = 1u << 30; bit; bit >>= 2) {
+		if (n >= root + bit) {
+			n -= root + bit;
+			root = (root >> 1) + bit;
+		} else {
+			root >>= 1;
+		}
+	}
+	return root;
+}
+
+uint8_t moonPhaseStep(float moonPhase) {
+	return static_cast<int>(moonPhase * 256.0f) & 255;
+}
+
+/*
+ * The lit part of each row runs from the limb to the terminator, an ellipse
+ * whose half width is the row's times cos(phase). Rows are worked out in
+ * half pixels, so the centre sits on the corner between the box's middle
+ * pixels; only the cosine is float, once per call. Like the bitmaps this
+ * replaced, the lit side is a dither that thins out over the last 6 px
+ * towards the terminator.
+*/
+void drawMoon(DisplayType& display, int16_t x, int16_t y, uint8_t phaseStep) {
+	static const uint8_t fadeLevels[] = {5, 4, 3, 2}; // 2 px each, then the rest
+	const int size = MOON_BOX;
+	const int radius = MOON_DIAMETER; // half pixels
+	int cosine = lroundf(cosf(phaseStep * float(2 * M_PI / 256)) * 256.0f);
+	bool waxing = phaseStep < 128;
+
+	FrameBuffer fb = frameBuffer(display);
+	for (int row = 0; row < size; row++) {
+		int dy = 2 * row + 1 - size;
+		if (abs(dy) > radius) continue;
+		int halfWidth = isqrt(radius * radius - dy * dy);
+		int terminator = halfWidth * cosine / 256;
+		// Columns with centres u = 2 * col + 1 - size inside the limb and
+		// past the terminator: u > terminator waxing, u < -terminator waning.
+		int col1 = (size - halfWidth) / 2;
+		int col2 = (size + halfWidth - 1) / 2;
+		if (waxing) col1 = std::max(col1, (size + terminator + 1) / 2);
+		else col2 = std::min(col2, (size - terminator) / 2 - 1);
+
+		int16_t rowY = y + row;
+		for (int band = 0; band < 4 && col1 <= col2; band++) {
+			int width = band < 3 ? 2 : col2 - col1 + 1;
+			int first = waxing ? col1 : std::max(col1, col2 - width + 1);
+			int last = waxing ? std::min(col2, col1 + width - 1) : col2;
+			fillPatternSpan(fb, x + first, x + last, rowY, ditherPatterns[fadeLevels[band]][rowY & 3]);
+			if (waxing) col1 = last + 1;
+			else col2 = first - 1;
+		}
+	}
+}
+
+static void drawCell(DisplayType& display, int i, const String& v, int moonStep) {
+	int ix = iconGap(display) + i * (ICON_SIZE + iconGap(display));
+	int iconY = bottomY(display) + 2;
+	int valY = iconY + ICON_SIZE + 18;
+	FrameBuffer fb = frameBuffer(display);
+	int16_t tbx, tby; uint16_t tbw, tbh;
+	textBounds(FreeSansBold18pt7bAtlas, v, ix + ICON_SIZE / 2, valY, &tbx, &tby, &tbw, &tbh);
+	drawText(fb, FreeSansBold18pt7bAtlas, ix + ICON_SIZE / 2 - tbw / 2, valY + tbh / 2, v);
+
+	const int iconW = 64;
+	const int iconH = 64;
+	int iconDrawX = ix + (ICON_SIZE - iconW) / 2;
+	int iconDrawY = iconY + (ICON_SIZE - iconH) / 2;
+	const uint8_t* icon = nullptr;
+	switch (i) {
+		case 0: icon = temp_icon_bits_packed; break;
+		case 1: icon = epd_bitmap_humidity_packed; break;
+		case 2: icon = epd_bitmap_sunrise_packed; break;
+		case 3: drawMoon(display, iconDrawX, iconDrawY + 25, moonStep); break;
+		case 4: icon = epd_bitmap_sunset_packed; break;
+		case 5: icon = epd_bitmap_co2_packed; break;
+		case 6: icon = epd_bitmap_pressure_packed; break;
+	}
+	if (icon) blitPackedBitmap(fb, iconDrawX, iconDrawY, icon, iconW, iconH);
+}
+
+static void contentHashes(
+		uint32_t* hashes,
+		float tempAir,
+		float humidity,
+		float co2,
+		float pressure,
+		const String& sunriseTime,
+		const String& sunsetTime,
+		const float* forecastTemp,
+		const float* forecastRain,
+		int forecastHours,
+		int forecastStartHour,
+		bool weatherDataValid,
+		int moonStep
+	) {
+	uint32_t forecastHash = hashBytes(2166136261u, &weatherDataValid, sizeof(weatherDataValid));
+	forecastHash = hashBytes(forecastHash, &forecastStartHour, sizeof(forecastStartHour));
+	hashes[REGION_HOURS] = forecastHash | 1;
+	hashes[REGION_GRAPH] = hashBytes(forecastHash, forecastTemp, forecastHours * sizeof(float)) | 1;
+	hashes[REGION_RAIN] = hashBytes(forecastHash, forecastRain, forecastHours * sizeof(float)) | 1;
+	for (int i = 0; i < ICON_COUNT; i++) {
+		String v = cellValue(i, tempAir, humidity, co2, pressure, sunriseTime, sunsetTime);
+		hashes[REGION_CELL_FIRST + i] = hashString(v, i == 3 ? moonStep : -1);
+	}
+}
+
+bool displayUpToDate(
+		float tempAir,
+		float humidity,
+		float co2,
+		float pressure,
+		const String& sunriseTime,
+		const String& sunsetTime,
+		const float* forecastTemp,
+		const float* forecastRain,
+		int forecastHours,
+		int forecastStartHour,
+		bool weatherDataValid,
+		float moonPhase
+	) {
+	uint32_t hashes[REGION_COUNT];
+	contentHashes(hashes, tempAir, humidity, co2, pressure, sunriseTime, sunsetTime, forecastTemp, forecastRain, forecastHours, forecastStartHour, weatherDataValid, moonPhaseStep(moonPhase));
+	return memcmp(hashes, rtc_regionHashes, sizeof(rtc_regionHashes)) == 0;
 }
 
 void updateDisplay(
@@ -235,60 +614,41 @@ void updateDisplay(
 		bool weatherDataValid,
 		float moonPhase
 	) {
-	display.setPartialWindow(0, 0, display.width(), display.height());
+	int moonStep = moonPhaseStep(moonPhase);
+
+	uint32_t hashes[REGION_COUNT];
+	contentHashes(hashes, tempAir, humidity, co2, pressure, sunriseTime, sunsetTime, forecastTemp, forecastRain, forecastHours, forecastStartHour, weatherDataValid, moonStep);
+
+	// One refresh over the bounding box of what changed.
+	bool changed[REGION_COUNT];
+	for (int i = 0; i < REGION_COUNT; i++) changed[i] = hashes[i] != rtc_regionHashes[i];
+	Rect box = regionsBox(display, changed);
+	if (box.w == 0) return;
+	int x1 = box.x, y1 = box.y, x2 = box.x + box.w, y2 = box.y + box.h;
+
+	// Everything that may reach into the window is drawn, the window clips it.
+	Rect cells = regionRect(display, REGION_CELL_FIRST);
+	bool forecastInWindow = y1 < rainY(display) + rainHeight(display);
+	bool cellsInWindow = y2 > cells.y;
+
+	display.setPartialWindow(x1, y1, x2 - x1, y2 - y1);
 	display.firstPage();
 	do {
 		display.fillScreen(GxEPD_WHITE);
-		drawWeatherForecast(display, forecastTemp, forecastRain, forecastHours, forecastStartHour, sunriseTime, sunsetTime, weatherDataValid);
-
-		int screenW = display.width();
-		int screenH = display.height();
-		int bottomH = std::max(64, screenH / 5);
-		int bottomY = screenH - bottomH - 16;
-
-		int icons = 7;
-		int iconSize = 56;
-		int gap = (screenW - icons * iconSize) / (icons + 1);
-		int iconY = bottomY + 2;
-		display.setFont(&FreeSans18pt7b);
-		
-		for (int i = 0; i < icons; i++) {
-			int ix = gap + i * (iconSize + gap);
-			int valY = iconY + iconSize + 18;
-			String v;
-			switch (i) {
-				case 0: v = String(tempAir, 1) + "C"; break;
-				case 1: v = String(humidity, 0) + "%"; break;
-				case 2: v = sunriseTime; break;
-				case 3: v = " "; break;
-				case 4: v = sunsetTime; break;
-				case 5: v = String(co2,0); break;
-				case 6: v = String(pressure,0); break;
-			}
-			display.setFont(&FreeSansBold18pt7b);
-			int16_t tbx, tby; uint16_t tbw, tbh;
-			display.getTextBounds(v, ix + iconSize / 2, valY, &tbx, &tby, &tbw, &tbh);
-			display.setCursor(ix + iconSize / 2 - tbw / 2, valY + tbh / 2);
-			display.print(v);
-			display.setFont(&FreeSans18pt7b);
-
-			const int iconW = 64;
-			const int iconH = 64;
-			int iconDrawX = ix + (iconSize - iconW) / 2;
-			int iconDrawY = iconY + (iconSize - iconH) / 2;
-			switch (i) {
-				case 0: display.drawBitmap(iconDrawX, iconDrawY, temp_icon_bits, iconW, iconH, GxEPD_BLACK); break;
-				case 1: display.drawBitmap(iconDrawX, iconDrawY, epd_bitmap_humidity, iconW, iconH, GxEPD_BLACK); break;
-				case 2: display.drawBitmap(iconDrawX, iconDrawY, epd_bitmap_sunrise, iconW, iconH, GxEPD_BLACK); break;
-				case 3: {
-					int moonIconIndex = static_cast<int>(moonPhase * 24.0f) % 24;
-					display.drawBitmap(iconDrawX, iconDrawY+25, epd_bitmap_allArray[moonIconIndex], iconW, iconH, GxEPD_BLACK);
-					break;
-				}
-				case 4: display.drawBitmap(iconDrawX, iconDrawY, epd_bitmap_sunset, iconW, iconH, GxEPD_BLACK); break;
-				case 5: display.drawBitmap(iconDrawX, iconDrawY, epd_bitmap_co2, iconW, iconH, GxEPD_BLACK); break;
-				case 6: display.drawBitmap(iconDrawX, iconDrawY, epd_bitmap_pressure, iconW, iconH, GxEPD_BLACK); break;
+		if (forecastInWindow) {
+			drawWeatherForecast(display, forecastTemp, forecastRain, forecastHours, forecastStartHour, sunriseTime, sunsetTime, weatherDataValid);
+		}
+		if (cellsInWindow) {
+			for (int i = 0; i < ICON_COUNT; i++) {
+				drawCell(display, i, cellValue(i, tempAir, humidity, co2, pressure, sunriseTime, sunsetTime), moonStep);
 			}
 		}
 	} while (display.nextPage());
+
+	FrameBuffer fb = frameBuffer(display);
+	for (int i = 0; i < REGION_COUNT; i++) {
+		if (changed[i]) addGhosting(display, fb, i);
+	}
+	rtc_partialRefreshes++;
+	memcpy(rtc_regionHashes, hashes, sizeof(rtc_regionHashes));
 }
@@ -1,20 +1,44 @@
 #pragma once
 #include <GxEPD2_BW.h>
-#include <Fonts/FreeSansBold18pt7b.h>
-#include <Fonts/FreeSans18pt7b.h>
-#include <Fonts/FreeSans12pt7b.h>
 #include <Arduino.h>
 
 typedef GxEPD2_BW<GxEPD2_397_GDEM0397T81, GxEPD2_397_GDEM0397T81::HEIGHT> DisplayType;
 
+// How the next update gets onto the panel, cheapest first.
+enum RefreshAction {
+  REFRESH_SKIP,     // the panel already shows it
+  REFRESH_PARTIAL,  // partial refresh of the changed regions
+  REFRESH_REGIONS,  // regions out of ghosting budget are flashed first
+  REFRESH_FULL      // full refresh to white first
+};
+
+// Picks the action from the ghosting budget kept in RTC memory.
+RefreshAction planRefresh(bool contentChanged);
+
+// Clears ghosting as planned, before updateDisplay() draws.
+void antiGhosting(DisplayType& display, RefreshAction action);
+
+// Full refresh to white, resets the whole budget.
 void largeAntiGhosting(DisplayType& display);
 
-void smallAntiGhosting(DisplayType& display);
+// Forgets what the panel shows, the next update is a full refresh.
+void refreshStateReset();
+
+// True when the panel already shows these values at display precision.
+bool displayUpToDate(float tempAir, float humidity, float co2, float pressure, const String& sunriseTime, const String& sunsetTime, const float* forecastTemp, const float* forecastRain, int forecastHours, int forecastStartHour, bool weatherDataValid, float moonPhase);
 
 void updateDisplay(DisplayType& display, float tempAir, float humidity, float co2, float pressure, const String& sunriseTime, const String& sunsetTime, const float* forecastTemp, const float* forecastRain, int forecastHours, int forecastStartHour, bool weatherDataValid, float moonPhase);
 
 void drawWeatherForecast(DisplayType& display, const float* forecastTemp, const float* forecastRain, int forecastHours, int forecastStartHour, const String& sunriseTime, const String& sunsetTime, bool weatherDataValid);
 
+void drawForecastTrail(DisplayType& display, int x, int y, int w, int h, const float* data, int dataSize, float minVal, float maxVal);
+
 void drawForecastGraph(DisplayType& display, int x, int y, int w, int h, const float* data, int dataSize, float minVal, float maxVal);
 
+// Moon phase (0 = new, 0.5 = full) in 1/256 turns, what drawMoon() resolves.
+uint8_t moonPhaseStep(float moonPhase);
+
+// Moon at the phase step, drawn into the 64 x 64 px box at (x, y).
+void drawMoon(DisplayType& display, int16_t x, int16_t y, uint8_t phaseStep);
+
 void drawRainColumns(DisplayType& display, int x, int y, int w, int h, const float* data, int dataSize, float maxVal);
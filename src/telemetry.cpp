@@ -0,0 +1,74 @@
+#include "telemetry.h"
+
+RTC_DATA_ATTR static TelemetryReading rtc_telemetryRing[TELEMETRY_CAPACITY];
+RTC_DATA_ATTR static uint8_t rtc_telemetryHead = 0;
+RTC_DATA_ATTR static uint8_t rtc_telemetryCount = 0;
+RTC_DATA_ATTR static uint32_t rtc_telemetryLastSent = 0;
+
+static uint8_t sentCount = 0;
+
+static int16_t toFixed(float value, float scale) {
+  return static_cast<int16_t>(constrain(lroundf(value * scale), -32768L, 32767L));
+}
+
+void telemetryRecord(uint32_t timestamp, float tempAir, float tempESP, float humidity, float co2, float pressure, float batteryVoltage) {
+  TelemetryReading& reading = rtc_telemetryRing[rtc_telemetryHead];
+  reading.timestamp = timestamp;
+  reading.tempAir = toFixed(tempAir, 100);
+  reading.tempESP = toFixed(tempESP, 100);
+  reading.humidity = toFixed(humidity, 100);
+  reading.co2 = toFixed(co2, 1);
+  reading.pressure = toFixed(pressure, 10);
+  reading.batteryVoltage = static_cast<uint16_t>(lroundf(batteryVoltage * 1000));
+
+  rtc_telemetryHead = (rtc_telemetryHead + 1) % TELEMETRY_CAPACITY;
+  if (rtc_telemetryCount < TELEMETRY_CAPACITY) rtc_telemetryCount++;
+}
+
+uint8_t telemetryCount() {
+  return rtc_telemetryCount;
+}
+
+String telemetryBulkJson(const char* apiKey, const String& status) {
+  String body;
+  body.reserve(64 + rtc_telemetryCount * 128 + status.length());
+  body += "{\"write_api_key\":\"";
+  body += apiKey;
+  body += "\",\"updates\":[";
+
+  uint32_t previous = rtc_telemetryLastSent;
+  for (int i = 0; i < rtc_telemetryCount; i++) {
+    const TelemetryReading& reading = rtc_telemetryRing[(rtc_telemetryHead + TELEMETRY_CAPACITY - rtc_telemetryCount + i) % TELEMETRY_CAPACITY];
+    // Seconds since the previous entry, 0 for the very first one.
+    uint32_t delta = previous ? reading.timestamp - previous : 0;
+    if (i > 0) body += ",";
+    body += "{\"delta_t\":" + String(delta);
+    body += ",\"field1\":" + String(reading.tempAir / 100.0f, 2);
+    body += ",\"field2\":" + String(reading.tempESP / 100.0f, 2);
+    body += ",\"field3\":" + String(reading.humidity / 100.0f, 2);
+    body += ",\"field4\":" + String(reading.co2);
+    body += ",\"field5\":" + String(reading.pressure / 10.0f, 0);
+    body += ",\"field6\":" + String(reading.batteryVoltage / 1000.0f, 4);
+    if (i == rtc_telemetryCount - 1) body += ",\"status\":\"" + status + "\"";
+    body += "}";
+    previous = reading.timestamp;
+  }
+  body += "]}";
+  sentCount = rtc_telemetryCount;
+  return body;
+}
+
+void telemetryClear() {
+  if (sentCount == 0) return;
+  uint8_t newest = (rtc_telemetryHead + TELEMETRY_CAPACITY - rtc_telemetryCount + sentCount - 1) % TELEMETRY_CAPACITY;
+  rtc_telemetryLastSent = rtc_telemetryRing[newest].timestamp;
+  rtc_telemetryCount -= sentCount;
+  sentCount = 0;
+}
+
+void telemetryReset() {
+  rtc_telemetryHead = 0;
+  rtc_telemetryCount = 0;
+  rtc_telemetryLastSent = 0;
+  sentCount = 0;
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <Arduino.h>
+
+/**
+ * Store-and-forward telemetry
+ *
+ * Each wake appends its readings to an RTC ring of TELEMETRY_CAPACITY
+ * entries. The ring is sent in one ThingSpeak bulk update and cleared once
+ * the upload is accepted; if uploads keep failing the oldest readings are
+ * overwritten. Four hours of readings ride out a 3 h AP outage plus the
+ * hour the WiFi backoff may take to notice it is back.
+**/
+
+#define TELEMETRY_CAPACITY 48
+
+// Fixed point to keep an entry at 16 bytes of RTC memory.
+struct TelemetryReading {
+  uint32_t timestamp;     // seconds on the RTC clock
+  int16_t tempAir;        // 0.01 °C
+  int16_t tempESP;        // 0.01 °C
+  int16_t humidity;       // 0.01 %
+  int16_t co2;            // ppm, negative for error codes
+  int16_t pressure;       // 0.1 hPa
+  uint16_t batteryVoltage; // mV
+};
+
+void telemetryRecord(uint32_t timestamp, float tempAir, float tempESP, float humidity, float co2, float pressure, float batteryVoltage);
+
+uint8_t telemetryCount();
+
+// ThingSpeak bulk_update.json body for every stored reading, oldest first.
+// `status` goes with the newest one.
+String telemetryBulkJson(const char* apiKey, const String& status);
+
+// Drops the readings included in the last telemetryBulkJson().
+void telemetryClear();
+
+// Drops every reading, for RTC memory that did not survive.
+void telemetryReset();
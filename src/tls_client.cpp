@@ -0,0 +1,200 @@
+#include "tls_client.h"
+
+// The last session, for the host it was negotiated with.
+struct TlsSessionCache {
+  uint32_t hostHash;  // 0 when empty
+  uint16_t length;
+  uint8_t data[TLS_SESSION_MAX_BYTES];
+};
+
+RTC_DATA_ATTR static TlsSessionCache rtc_tlsSession = {};
+static int sessionSaveError = 0;
+
+static uint32_t hostHash(const char* host) {
+  uint32_t hash = 2166136261u;
+  while (*host) hash = (hash ^ static_cast<uint8_t>(*host++)) * 16777619u; // FNV-1a
+  return hash ? hash : 1;
+}
+
+void tlsSessionClear() {
+  rtc_tlsSession.hostHash = 0;
+  rtc_tlsSession.length = 0;
+}
+
+int tlsSessionSaveError() {
+  return sessionSaveError;
+}
+
+static void saveSession(const mbedtls_ssl_context& ssl, const char* host) {
+  size_t length = 0;
+  sessionSaveError = tlsSessionSave(&ssl, rtc_tlsSession.data, sizeof(rtc_tlsSession.data), &length);
+  if (sessionSaveError == 0) {
+    rtc_tlsSession.hostHash = hostHash(host);
+    rtc_tlsSession.length = length;
+  } else {
+    tlsSessionClear();
+  }
+}
+
+ResumableTlsClient::ResumableTlsClient() {}
+
+ResumableTlsClient::~ResumableTlsClient() {
+  stop();
+}
+
+int ResumableTlsClient::connect(const char* host, uint16_t port) {
+  return connect(host, port, getTimeout());
+}
+
+int ResumableTlsClient::connect(const char* host, uint16_t port, int32_t timeout) {
+  stop();
+  if (!_tcp.connect(host, port, timeout)) return 0;
+  // HTTPClient sets the stream timeout only once connected.
+  _handshakeTimeoutMs = timeout > 0 ? timeout : getTimeout();
+  bool resume = rtc_tlsSession.hostHash == hostHash(host);
+  int ret = handshake(host, resume);
+
+  // A server that aborts on the offered session gets a clean full handshake.
+  if (ret != 0 && resume) {
+    tlsSessionClear();
+    release();
+    _tcp.stop();
+    if (!_tcp.connect(host, port, timeout)) return 0;
+    ret = handshake(host, false);
+  }
+  _handshakeTimeoutMs = 0;
+  if (ret != 0) {
+    release();
+    _tcp.stop();
+    return 0;
+  }
+
+  saveSession(_ssl, host);
+  return 1;
+}
+
+int ResumableTlsClient::handshake(const char* host, bool resume) {
+  mbedtls_ssl_init(&_ssl);
+  mbedtls_ssl_config_init(&_conf);
+  mbedtls_entropy_init(&_entropy);
+  mbedtls_ctr_drbg_init(&_drbg);
+  _ready = true;
+
+  int ret = mbedtls_ctr_drbg_seed(&_drbg, mbedtls_entropy_func, &_entropy, nullptr, 0);
+  if (ret == 0) ret = mbedtls_ssl_config_defaults(&_conf, MBEDTLS_SSL_IS_CLIENT, MBEDTLS_SSL_TRANSPORT_STREAM, MBEDTLS_SSL_PRESET_DEFAULT);
+  if (ret != 0) return ret;
+  mbedtls_ssl_conf_authmode(&_conf, MBEDTLS_SSL_VERIFY_NONE);
+  mbedtls_ssl_conf_rng(&_conf, mbedtls_ctr_drbg_random, &_drbg);
+  mbedtls_ssl_conf_session_tickets(&_conf, MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
+  if ((ret = mbedtls_ssl_setup(&_ssl, &_conf)) != 0) return ret;
+  if ((ret = mbedtls_ssl_set_hostname(&_ssl, host)) != 0) return ret;
+  mbedtls_ssl_set_bio(&_ssl, this, sendCallback, receiveCallback, nullptr);
+
+  // A session saved by another mbedTLS build does not load and is not offered.
+  if (resume) {
+    mbedtls_ssl_session session;
+    mbedtls_ssl_session_init(&session);
+    if (mbedtls_ssl_session_load(&session, rtc_tlsSession.data, rtc_tlsSession.length) == 0) {
+      mbedtls_ssl_set_session(&_ssl, &session);
+    }
+    mbedtls_ssl_session_free(&session);
+  }
+
+  while ((ret = mbedtls_ssl_handshake(&_ssl)) != 0) {
+    if (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) return ret;
+  }
+  return 0;
+}
+
+void ResumableTlsClient::release() {
+  if (!_ready) return;
+  mbedtls_ssl_free(&_ssl);
+  mbedtls_ssl_config_free(&_conf);
+  mbedtls_ctr_drbg_free(&_drbg);
+  mbedtls_entropy_free(&_entropy);
+  _ready = false;
+  _peeked = -1;
+}
+
+int ResumableTlsClient::sendCallback(void* context, const unsigned char* buffer, size_t length) {
+  ResumableTlsClient* client = static_cast<ResumableTlsClient*>(context);
+  size_t sent = client->_tcp.write(buffer, length);
+  return sent > 0 ? static_cast<int>(sent) : MBEDTLS_ERR_SSL_CONN_EOF;
+}
+
+// Blocks up to the connect timeout during the handshake, then up to the
+// stream timeout, as WiFiClientSecure does.
+int ResumableTlsClient::receiveCallback(void* context, unsigned char* buffer, size_t length) {
+  ResumableTlsClient* client = static_cast<ResumableTlsClient*>(context);
+  unsigned long timeout = client->_handshakeTimeoutMs ? client->_handshakeTimeoutMs : client->getTimeout();
+  unsigned long start = millis();
+  while (client->_tcp.available() <= 0) {
+    if (!client->_tcp.connected()) return MBEDTLS_ERR_SSL_CONN_EOF;
+    if (millis() - start >= timeout) return MBEDTLS_ERR_SSL_TIMEOUT;
+    delay(1);
+  }
+  int received = client->_tcp.read(buffer, length);
+  return received > 0 ? received : MBEDTLS_ERR_SSL_WANT_READ;
+}
+
+size_t ResumableTlsClient::write(uint8_t c) {
+  return write(&c, 1);
+}
+
+size_t ResumableTlsClient::write(const uint8_t* buffer, size_t size) {
+  if (!_ready) return 0;
+  size_t sent = 0;
+  while (sent < size) {
+    int ret = mbedtls_ssl_write(&_ssl, buffer + sent, size - sent);
+    if (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE) continue;
+    if (ret <= 0) break;
+    sent += ret;
+  }
+  return sent;
+}
+
+// Decrypts the next record if only the socket has data, so a record that
+// holds no application data does not count.
+int ResumableTlsClient::available() {
+  if (!_ready) return 0;
+  size_t pending = mbedtls_ssl_get_bytes_avail(&_ssl) + (_peeked >= 0);
+  if (pending == 0 && _tcp.available() > 0 && peek() >= 0) pending = mbedtls_ssl_get_bytes_avail(&_ssl) + 1;
+  return static_cast<int>(pending);
+}
+
+int ResumableTlsClient::read() {
+  uint8_t c;
+  return read(&c, 1) == 1 ? c : -1;
+}
+
+int ResumableTlsClient::read(uint8_t* buffer, size_t size) {
+  if (!_ready || size == 0) return -1;
+  size_t count = 0;
+  if (_peeked >= 0) {
+    buffer[count++] = static_cast<uint8_t>(_peeked);
+    _peeked = -1;
+    if (count == size || mbedtls_ssl_get_bytes_avail(&_ssl) == 0) return count;
+  }
+  int ret = mbedtls_ssl_read(&_ssl, buffer + count, size - count);
+  if (ret > 0) return count + ret;
+  return count > 0 ? static_cast<int>(count) : -1;
+}
+
+int ResumableTlsClient::peek() {
+  if (_peeked < 0) _peeked = read();
+  return _peeked;
+}
+
+void ResumableTlsClient::flush() {
+  _tcp.flush();
+}
+
+void ResumableTlsClient::stop() {
+  if (_ready) mbedtls_ssl_close_notify(&_ssl);
+  release();
+  _tcp.stop();
+}
+
+uint8_t ResumableTlsClient::connected() {
+  return _ready && (_peeked >= 0 || mbedtls_ssl_get_bytes_avail(&_ssl) > 0 || _tcp.connected());
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <Arduino.h>
+#include <WiFi.h>
+#include <mbedtls/ssl.h>
+#include <mbedtls/entropy.h>
+#include <mbedtls/ctr_drbg.h>
+#include "tls_session.h"
+
+/**
+ * HTTPS transport that resumes its TLS session across deep sleep
+ *
+ * A full handshake (ECDHE and the server's certificate chain) is most of
+ * the forecast fetch on the ESP32-C3. After one, the session the server
+ * handed out (a ticket, or just the session ID) is serialized into RTC
+ * memory with tlsSessionSave(). The next connect to the same
+ * host offers it: if the server accepts, the handshake is abbreviated to
+ * one round trip of symmetric crypto. A declined or expired session makes
+ * the server answer with a full handshake, and one that fails outright is
+ * dropped and retried without it.
+ *
+ * Pass it to HTTPClient::begin(client, url); it does the TLS that
+ * HTTPClient would otherwise do with WiFiClientSecure. Like HTTPClient
+ * without a CA certificate, it does not verify the server.
+**/
+
+class ResumableTlsClient : public WiFiClient {
+  public:
+    ResumableTlsClient();
+    ~ResumableTlsClient();
+
+    int connect(const char* host, uint16_t port) override;
+    int connect(const char* host, uint16_t port, int32_t timeout) override;
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buffer, size_t size) override;
+    int available() override;
+    int read() override;
+    int read(uint8_t* buffer, size_t size) override;
+    int peek() override;
+    void flush() override;
+    void stop() override;
+    uint8_t connected() override;
+
+  private:
+    WiFiClient _tcp;
+    mbedtls_ssl_context _ssl;
+    mbedtls_ssl_config _conf;
+    mbedtls_entropy_context _entropy;
+    mbedtls_ctr_drbg_context _drbg;
+    bool _ready = false;
+    int _peeked = -1;
+    uint32_t _handshakeTimeoutMs = 0;  // connect()'s timeout while handshaking, then 0
+
+    int handshake(const char* host, bool resume);
+    void release();
+    static int sendCallback(void* context, const unsigned char* buffer, size_t length);
+    static int receiveCallback(void* context, unsigned char* buffer, size_t length);
+};
+
+// Forgets the stored session, the next connect does a full handshake.
+void tlsSessionClear();
+
+// mbedTLS error of the last session that could not be saved, 0 once one
+// is saved again. Without a saved session every fetch does a full handshake.
+int tlsSessionSaveError();
@@ -0,0 +1,26 @@
+#include "tls_session.h"
+
+#if defined(MBEDTLS_SSL_KEEP_PEER_CERTIFICATE)
+#include <mbedtls/platform.h>
+#endif
+
+// mbedTLS 3 hides the session's fields behind MBEDTLS_PRIVATE().
+#ifndef MBEDTLS_PRIVATE
+#define MBEDTLS_PRIVATE(member) member
+#endif
+
+int tlsSessionSave(const mbedtls_ssl_context* ssl, unsigned char* buffer, size_t size, size_t* length) {
+  mbedtls_ssl_session session;
+  mbedtls_ssl_session_init(&session);
+  int ret = mbedtls_ssl_get_session(ssl, &session);
+  #if defined(MBEDTLS_SSL_KEEP_PEER_CERTIFICATE)
+    if (ret == 0 && session.MBEDTLS_PRIVATE(peer_cert) != NULL) {
+      mbedtls_x509_crt_free(session.MBEDTLS_PRIVATE(peer_cert));
+      mbedtls_free(session.MBEDTLS_PRIVATE(peer_cert));
+      session.MBEDTLS_PRIVATE(peer_cert) = NULL;
+    }
+  #endif
+  if (ret == 0) ret = mbedtls_ssl_session_save(&session, buffer, size, length);
+  mbedtls_ssl_session_free(&session);
+  return ret;
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include <mbedtls/ssl.h>
+
+/**
+ * Serialized TLS session, as ResumableTlsClient keeps it in RTC memory
+ *
+ * mbedTLS keeps the server's certificate in the session when built with
+ * MBEDTLS_SSL_KEEP_PEER_CERTIFICATE, as the ESP32 Arduino core is, and
+ * mbedtls_ssl_session_save() writes it out. The server is never verified
+ * and a resumed handshake does not send the certificate again, so it is
+ * dropped before saving. What is left is the session ID, the master
+ * secret and the server's ticket.
+ *
+ * Only needs mbedTLS, so test/tls_session_test.cpp can run it against the
+ * real library.
+**/
+
+#define TLS_SESSION_MAX_BYTES 512
+
+// Saves the session `ssl` negotiated into `buffer`, without the peer
+// certificate. 0 or an mbedTLS error, e.g. MBEDTLS_ERR_SSL_BUFFER_TOO_SMALL.
+int tlsSessionSave(const mbedtls_ssl_context* ssl, unsigned char* buffer, size_t size, size_t* length);
@@ -0,0 +1,40 @@
+#include "wake_budget.h"
+
+RTC_DATA_ATTR static uint32_t rtc_worstWakeMs = 0;
+RTC_DATA_ATTR static uint16_t rtc_wakesOverBudget = 0;
+
+WakeBudget::WakeBudget(uint32_t budgetMs) : _startMs(millis()), _budgetMs(budgetMs) {}
+
+uint32_t WakeBudget::elapsedMs() const {
+  return millis() - _startMs;
+}
+
+uint32_t WakeBudget::remainingMs() const {
+  uint32_t elapsed = elapsedMs();
+  return elapsed < _budgetMs ? _budgetMs - elapsed : 0;
+}
+
+bool WakeBudget::allows(uint32_t ms, uint32_t reserveMs) const {
+  return remainingMs() >= ms + reserveMs;
+}
+
+uint32_t WakeBudget::timeoutMs(uint32_t wantedMs, uint32_t reserveMs) const {
+  uint32_t remaining = remainingMs();
+  uint32_t available = remaining > reserveMs ? remaining - reserveMs : 0;
+  return min(wantedMs, available);
+}
+
+void WakeBudget::finish() const {
+  uint32_t elapsed = elapsedMs();
+  rtc_worstWakeMs = max(rtc_worstWakeMs, elapsed);
+  if (elapsed > _budgetMs && rtc_wakesOverBudget < UINT16_MAX) rtc_wakesOverBudget++;
+}
+
+String wakeBudgetSummary() {
+  return "worst:" + String(rtc_worstWakeMs) + ",over:" + String(rtc_wakesOverBudget);
+}
+
+void wakeBudgetReset() {
+  rtc_worstWakeMs = 0;
+  rtc_wakesOverBudget = 0;
+}
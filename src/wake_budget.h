@@ -0,0 +1,49 @@
+#pragma once
+#include <Arduino.h>
+
+/**
+ * Time budget of one wake
+ *
+ * A wake normally takes about 6 s, most of it the CO2 conversion. A slow
+ * AP, a stalled server and an FRC recalibration could otherwise add up to
+ * tens of seconds, with the radio on for much of it. setup() creates one
+ * WakeBudget and passes it to every step that can block. Before starting,
+ * a step asks whether the time it needs is left, keeping back what later
+ * steps need. If it is not, the step is skipped and its work stays queued
+ * for the next wake: readings stay in the telemetry ring, the forecast
+ * stays due and ghosting stays counted. Timeouts of blocking calls are cut
+ * to what is left.
+ *
+ * The longest wake and the number of wakes over budget since power-up are
+ * kept in RTC memory and go out with the readings.
+**/
+
+#define WAKE_BUDGET_MS 12000
+
+class WakeBudget {
+  public:
+    explicit WakeBudget(uint32_t budgetMs);
+
+    uint32_t elapsedMs() const;
+    uint32_t remainingMs() const;
+    bool expired() const { return remainingMs() == 0; }
+
+    // True if `ms` still fit with `reserveMs` kept for later steps.
+    bool allows(uint32_t ms, uint32_t reserveMs = 0) const;
+
+    // `wantedMs`, cut to what is left with `reserveMs` kept for later steps.
+    uint32_t timeoutMs(uint32_t wantedMs, uint32_t reserveMs = 0) const;
+
+    // Records the length of the wake, once at its end.
+    void finish() const;
+
+  private:
+    unsigned long _startMs;
+    uint32_t _budgetMs;
+};
+
+// "worst:<ms>,over:<wakes>" since power-up.
+String wakeBudgetSummary();
+
+// Back to the state of power-up.
+void wakeBudgetReset();
@@ -0,0 +1,37 @@
+#include "wifi_health.h"
+
+RTC_DATA_ATTR static WiFiHealth rtc_wifiHealth = {};
+
+bool wifiAttemptDue(uint32_t nowS) {
+  return rtc_wifiHealth.failures == 0 || nowS >= rtc_wifiHealth.retryAtS;
+}
+
+uint32_t wifiConnectTimeoutMs() {
+  if (rtc_wifiHealth.connectMs == 0) return WIFI_TIMEOUT_MAX_MS;
+  return constrain(3UL * rtc_wifiHealth.connectMs, (unsigned long)WIFI_TIMEOUT_MIN_MS, (unsigned long)WIFI_TIMEOUT_MAX_MS);
+}
+
+void wifiReportConnected(uint32_t connectMs) {
+  connectMs = min(connectMs, (uint32_t)WIFI_TIMEOUT_MAX_MS);
+  // Moving average over about 4 connects, seeded by the first.
+  uint16_t& average = rtc_wifiHealth.connectMs;
+  average = average == 0 ? connectMs : (3 * average + connectMs) / 4;
+  if (average == 0) average = 1;
+  rtc_wifiHealth.failures = 0;
+  rtc_wifiHealth.retryAtS = 0;
+}
+
+void wifiReportFailed(uint32_t nowS) {
+  if (rtc_wifiHealth.failures < UINT8_MAX) rtc_wifiHealth.failures++;
+  uint8_t doublings = min(rtc_wifiHealth.failures - 1, 4);
+  uint32_t backoffS = min((uint32_t)WIFI_BACKOFF_BASE_S << doublings, (uint32_t)WIFI_BACKOFF_MAX_S);
+  rtc_wifiHealth.retryAtS = nowS + backoffS;
+}
+
+const WiFiHealth& wifiHealth() {
+  return rtc_wifiHealth;
+}
+
+void wifiHealthReset() {
+  rtc_wifiHealth = {};
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <Arduino.h>
+
+/**
+ * Access point health across deep sleep
+ *
+ * Each wake that brings the radio up reports whether WiFi connected and
+ * how long it took. A failure backs the next attempt off, doubling from
+ * one wake interval up to WIFI_BACKOFF_MAX_S, so an unreachable AP costs
+ * one short attempt now and then instead of a 10 s scan every wake.
+ * Readings keep queueing in the telemetry ring meanwhile.
+ *
+ * The connect timeout follows how long connecting usually takes, so a wake
+ * keeps the radio on only a few times longer than a good connect would.
+**/
+
+#define WIFI_BACKOFF_BASE_S 300    // one wake interval
+#define WIFI_BACKOFF_MAX_S 3600
+#define WIFI_TIMEOUT_MIN_MS 4000   // fast connect fallback + scan + DHCP, with margin
+#define WIFI_TIMEOUT_MAX_MS 10000  // also the timeout until the first connect
+
+struct WiFiHealth {
+  uint8_t failures;    // consecutive failed attempts
+  uint16_t connectMs;  // smoothed time to connect, 0 until the first one
+  uint32_t retryAtS;   // no attempt before this, on the RTC clock
+};
+
+// Whether this wake may bring the radio up. `nowS` is the wake's start.
+bool wifiAttemptDue(uint32_t nowS);
+
+// How long to wait for the connection before giving up on this wake.
+uint32_t wifiConnectTimeoutMs();
+
+void wifiReportConnected(uint32_t connectMs);
+void wifiReportFailed(uint32_t nowS);
+
+const WiFiHealth& wifiHealth();
+
+// Back to the state of power-up.
+void wifiHealthReset();
@@ -0,0 +1,147 @@
+// Host benchmark of the PackBits compressed drawing assets: flash taken by
+// each icon and glyph atlas packed and unpacked, against the time to draw
+// it with blitPackedBitmap() and with blitBitmap() from unpacked bytes. Both
+// must produce identical pixels, at every X alignment and both landscape
+// rotations.
+//   pio run -e bench_assets -t exec
+#include <Arduino.h>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+#include "../src/rendering.h"
+#include "../src/framebuffer.h"
+#include "../src/glyphs.h"
+#include "glyph_atlas.h"
+#include "icons.h"
+
+const int ITERATIONS = 2000;
+
+DisplayType display(GxEPD2_397_GDEM0397T81(-1, -1, -1, -1));
+
+struct Bitmap {
+  const uint8_t* packed;
+  std::vector<uint8_t> unpacked;
+  int16_t w, h;
+};
+
+struct Asset {
+  const char* name;
+  size_t packedBytes;
+  std::vector<Bitmap> bitmaps;
+};
+
+// Reference decoder, the format as tools/pack_assets.py writes it.
+static std::vector<uint8_t> unpack(const uint8_t* packed, size_t size) {
+  std::vector<uint8_t> out;
+  while (out.size() < size) {
+    uint8_t n = *packed++;
+    if (n < 128) {
+      out.insert(out.end(), packed, packed + n + 1);
+      packed += n + 1;
+    } else if (n > 128) {
+      out.insert(out.end(), 257 - n, *packed++);
+    }
+  }
+  return out;
+}
+
+static Bitmap bitmap(const uint8_t* packed, int16_t w, int16_t h) {
+  return Bitmap{packed, unpack(packed, w / 8 * h), w, h};
+}
+
+static Asset icon(const char* name, const uint8_t* packed, size_t packedBytes) {
+  return Asset{name, packedBytes, {bitmap(packed, 64, 64)}};
+}
+
+static Asset atlas(const char* name, const GlyphAtlas& atlas, size_t packedBytes) {
+  Asset asset{name, packedBytes, {}};
+  for (uint8_t i = 0; i < atlas.count; i++) {
+    const AtlasGlyph& glyph = atlas.glyphs[i];
+    if (glyph.width == 0 || glyph.height == 0) continue;
+    asset.bitmaps.push_back(bitmap(atlas.bitmap + glyph.offset, (glyph.width + 7) & ~7, glyph.height));
+  }
+  return asset;
+}
+
+static std::vector<uint8_t> snapshot() {
+  FrameBuffer fb = frameBuffer(display);
+  std::vector<uint8_t> pixels(fb.width * fb.height);
+  for (int16_t y = 0; y < fb.height; y++) {
+    for (int16_t x = 0; x < fb.width; x++) pixels[y * fb.width + x] = frameBufferPixel(fb, x, y);
+  }
+  return pixels;
+}
+
+// Every bitmap of the asset once at each of the 8 X alignments.
+static void drawAsset(const Asset& asset, bool packed) {
+  FrameBuffer fb = frameBuffer(display);
+  for (int shift = 0; shift < 8; shift++) {
+    int16_t x = 3 + shift, y = 3 + shift * 58;
+    for (const Bitmap& b : asset.bitmaps) {
+      if (packed) blitPackedBitmap(fb, x, y, b.packed, b.w, b.h);
+      else blitBitmap(fb, x, y, b.unpacked.data(), b.w, b.h);
+      x += b.w + 9;
+    }
+  }
+}
+
+static double timeAsset(const Asset& asset, bool packed, std::vector<uint8_t>& pixels) {
+  double totalUs = 0;
+  for (int i = 0; i < ITERATIONS; i++) {
+    display.fillScreen(GxEPD_WHITE);
+    auto start = std::chrono::steady_clock::now();
+    drawAsset(asset, packed);
+    totalUs += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+  }
+  pixels = snapshot();
+  return totalUs / ITERATIONS / 8;
+}
+
+int main() {
+  Asset assets[] = {
+    icon("temp", temp_icon_bits_packed, sizeof(temp_icon_bits_packed)),
+    icon("humidity", epd_bitmap_humidity_packed, sizeof(epd_bitmap_humidity_packed)),
+    icon("sunrise", epd_bitmap_sunrise_packed, sizeof(epd_bitmap_sunrise_packed)),
+    icon("sunset", epd_bitmap_sunset_packed, sizeof(epd_bitmap_sunset_packed)),
+    icon("co2", epd_bitmap_co2_packed, sizeof(epd_bitmap_co2_packed)),
+    icon("pressure", epd_bitmap_pressure_packed, sizeof(epd_bitmap_pressure_packed)),
+    atlas("bold 18", FreeSansBold18pt7bAtlas, sizeof(FreeSansBold18pt7bAtlasBitmap)),
+    atlas("sans 18", FreeSans18pt7bAtlas, sizeof(FreeSans18pt7bAtlasBitmap)),
+    atlas("sans 12", FreeSans12pt7bAtlas, sizeof(FreeSans12pt7bAtlasBitmap)),
+  };
+
+  bool ok = true;
+  size_t totalRaw = 0, totalPacked = 0;
+  printf("%-9s %8s %8s %7s %11s %11s\n", "asset", "raw", "packed", "saved", "blit", "packed blit");
+  for (const Asset& asset : assets) {
+    size_t raw = 0;
+    for (const Bitmap& b : asset.bitmaps) raw += b.unpacked.size();
+    totalRaw += raw;
+    totalPacked += asset.packedBytes;
+
+    bool same = true;
+    double rawUs = 0, packedUs = 0;
+    for (uint8_t rotation : {0, 2}) {
+      display.setRotation(rotation);
+      std::vector<uint8_t> reference, packed;
+      rawUs += timeAsset(asset, false, reference) / 2;
+      packedUs += timeAsset(asset, true, packed) / 2;
+      same &= reference == packed;
+    }
+    ok &= same;
+    printf("%-9s %6zu B %6zu B %6.1f%% %8.2f us %8.2f us%s\n", asset.name, raw, asset.packedBytes,
+      100.0 * (1.0 - double(asset.packedBytes) / raw), rawUs, packedUs, same ? "" : "  MISMATCH");
+  }
+  printf("%-9s %6zu B %6zu B %6.1f%%\n", "total", totalRaw, totalPacked, 100.0 * (1.0 - double(totalPacked) / totalRaw));
+
+  // Clipped by a partial window that starts mid-asset.
+  display.setRotation(2);
+  display.setPartialWindow(40, 20, 96, 300);
+  std::vector<uint8_t> reference, packed;
+  timeAsset(assets[0], false, reference);
+  timeAsset(assets[0], true, packed);
+  bool same = reference == packed;
+  ok &= same;
+  printf("\npartial window clipping%s\n", same ? " ok" : "  MISMATCH");
+  return ok ? 0 : 1;
+}
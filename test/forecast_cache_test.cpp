@@ -0,0 +1,74 @@
+// Host test of the forecast cache: runs the firmware's wake cycle for 30
+// hours, then with every HTTP server stalled for 26 hours, then with the
+// servers back. Checks that the forecast is fetched every 6 h, that the
+// cached one stays drawn while refetches fail, is hidden once less than a
+// day of it is left (the null hours past the model run don't count), and
+// comes back soon after the servers do. The drawn day must start at the
+// hour of the wake, also when the fetch was in the middle of an hour.
+//   pio run -e test_forecast_cache -t exec
+#include <Arduino.h>
+#include <cstdio>
+#include <cstdlib>
+#include <sim_test.h>
+#include "forecast.h"
+
+extern bool forecastShown;
+extern ForecastWindow shownForecast;
+
+const int WAKES_PER_HOUR = 12;
+const uint32_t SERVER_STALL_MS = 20000;
+
+// False once a drawn window held a temperature no forecast gives.
+static bool temperaturesReal = true;
+// False once a drawn window started at another hour than the wake's.
+static bool hoursCurrent = true;
+
+// Runs `hours` of wakes, false if the forecast was hidden in any of them.
+static bool runHours(int hours) {
+  bool shown = true;
+  for (int i = 0; i < hours * WAKES_PER_HOUR; i++) {
+    int wakeHour = sim::wallClock() % 86400 / 3600;
+    sim::runWake();
+    shown &= forecastShown;
+    hoursCurrent &= !forecastShown || shownForecast.startHour == wakeHour;
+    for (int h = 0; forecastShown && h < FORECAST_HOURS; h++) {
+      temperaturesReal &= shownForecast.temp[h] > -60.0f && shownForecast.temp[h] < 60.0f;
+    }
+  }
+  return shown;
+}
+
+int main() {
+  setenv("TZ", "UTC0", 1);
+  tzset();
+  bool ok = true;
+
+  // Fetched on power-up and at 6, 12, 18 and 24 h.
+  bool shown = runHours(30);
+  printf("forecasts fetched in 30 h: %u\n", sim::forecastResponses());
+  ok &= sim::expect(shown, "the forecast is drawn on every wake");
+  ok &= sim::expect(sim::forecastResponses() == 5, "it is fetched every 6 h");
+
+  // The last fetch was at 24 h, from the 21 h model run, which ends at
+  // 69 h. Its last full day starts at 45 h.
+  sim::setServerStallMs(SERVER_STALL_MS);
+  shown = runHours(16);
+  ok &= sim::expect(shown, "a failing fetch leaves the cached forecast drawn");
+  runHours(2);
+  ok &= sim::expect(!forecastShown, "...until less than a day of it is left");
+  ok &= sim::expect(temperaturesReal, "hours past the model run are never drawn");
+  runHours(8);
+  ok &= sim::expect(sim::forecastResponses() == 5 && !forecastShown, "no forecast while the server is down");
+
+  // Back at 56:10, so the next fetch is in the middle of an hour.
+  sim::runWake();
+  sim::runWake();
+  sim::setServerStallMs(0);
+  for (int i = 0; i < 3; i++) sim::runWake();
+  ok &= sim::expect(sim::forecastResponses() == 6 && forecastShown, "a stale cache is refetched within 15 min");
+
+  // That fetch was at 56:15, the drawn day has to move on at 57:00.
+  runHours(2);
+  ok &= sim::expect(hoursCurrent, "the drawn day starts at the hour of the wake");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,238 @@
+// Host regression suite of updateDisplay(): every scenario is rendered from
+// a cleared panel into the simulated GDEM0397 and compared with its PBM in
+// test/golden (as a viewer sees it, 1 = black). A mismatch leaves the
+// render next to the golden as <name>.actual.pbm, and so does a missing
+// golden, which fails too. GOLDEN_UPDATE=1 records them all after an
+// intended change.
+// Frames with text depend on the Adafruit GFX fonts. Until their goldens
+// are recorded from a build with the pinned library, only the moon sheet
+// is checked and the text scenarios are only timed, see TEXT_GOLDENS.
+// Render time is the fastest of a few runs of the whole updateDisplay(),
+// for the moon phases the mean of the partial updates.
+//   pio run -e test_golden -t exec
+#include <Arduino.h>
+#include <GxEPD2_BW.h>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "../src/rendering.h"
+
+const int HOURS = 24;
+const int RUNS = 20;
+const int MOON_STEPS = 256;
+const int MOON_SHEET_COLUMNS = 16;
+// Set once test/golden holds the text scenarios, recorded with the pinned fonts.
+const bool TEXT_GOLDENS = false;
+
+DisplayType display(GxEPD2_397_GDEM0397T81(-1, -1, -1, -1));
+
+struct Scenario {
+  const char* name;
+  float tempAir, humidity, co2, pressure;
+  String sunrise, sunset;
+  float temp[HOURS], rain[HOURS];
+  int startHour;
+  bool weatherValid;
+  float moonPhase;
+};
+
+static Scenario scenario(const char* name, float mean, float swing, float rainPeak) {
+  Scenario s{name, 21.4f, 48.0f, 812.0f, 1013.0f, "07:12", "19:48", {}, {}, 6, true, 0.3f};
+  for (int i = 0; i < HOURS; i++) {
+    s.temp[i] = mean + swing * sinf((i - 3) * 2.0f * float(M_PI) / HOURS);
+    float shower = 1.0f - fabsf(i - 15.0f) / 5.0f;
+    s.rain[i] = shower > 0 ? rainPeak * shower : 0;
+  }
+  return s;
+}
+
+// The panel as writePanelPbm() stores it.
+static std::vector<uint8_t> panelPbm() {
+  const char* path = "golden_test.tmp.pbm";
+  sim::writePanelPbm(path);
+  FILE* f = fopen(path, "rb");
+  std::vector<uint8_t> bytes;
+  int c;
+  while ((c = fgetc(f)) != EOF) bytes.push_back(c);
+  fclose(f);
+  remove(path);
+  return bytes;
+}
+
+static bool readFile(const std::string& path, std::vector<uint8_t>& bytes) {
+  FILE* f = fopen(path.c_str(), "rb");
+  if (!f) return false;
+  int c;
+  while ((c = fgetc(f)) != EOF) bytes.push_back(c);
+  fclose(f);
+  return true;
+}
+
+static void writeFile(const std::string& path, const std::vector<uint8_t>& bytes) {
+  FILE* f = fopen(path.c_str(), "wb");
+  if (f) {
+    fwrite(bytes.data(), 1, bytes.size(), f);
+    fclose(f);
+  }
+}
+
+static size_t differingPixels(const std::vector<uint8_t>& a, const std::vector<uint8_t>& b) {
+  if (a.size() != b.size()) return SIZE_MAX;
+  size_t count = 0;
+  for (size_t i = 0; i < a.size(); i++) count += __builtin_popcount(a[i] ^ b[i]);
+  return count;
+}
+
+static void clearPanel() {
+  display.setFullWindow();
+  largeAntiGhosting(display);
+}
+
+static void render(const Scenario& s) {
+  updateDisplay(display, s.tempAir, s.humidity, s.co2, s.pressure, s.sunrise, s.sunset, s.temp, s.rain, HOURS, s.startHour, s.weatherValid, s.moonPhase);
+}
+
+static double renderUs(const Scenario& s) {
+  double best = 1e9;
+  for (int i = 0; i < RUNS; i++) {
+    clearPanel();
+    auto start = std::chrono::steady_clock::now();
+    render(s);
+    best = std::min(best, std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+  }
+  return best;
+}
+
+// Compares (or records) the image, prints the row and returns false on a
+// mismatch or a missing golden. An image that is not `checked` is only
+// recorded.
+static bool check(const char* name, const std::vector<uint8_t>& image, double us, bool checked = true) {
+  std::string dir = getenv("GOLDEN_DIR") ? getenv("GOLDEN_DIR") : "test/golden";
+  std::string path = dir + "/" + name + ".pbm";
+  std::string actualPath = dir + "/" + name + ".actual.pbm";
+  bool update = getenv("GOLDEN_UPDATE") && atoi(getenv("GOLDEN_UPDATE"));
+  std::vector<uint8_t> golden;
+  const char* result = "ok";
+  bool ok = true;
+  if (update) {
+    writeFile(path, image);
+    result = "recorded";
+  } else if (!checked) {
+    result = "not checked (record with the pinned fonts)";
+  } else if (!readFile(path, golden)) {
+    writeFile(actualPath, image);
+    result = "MISSING (GOLDEN_UPDATE=1 records it)";
+    ok = false;
+  } else if (golden != image) {
+    writeFile(actualPath, image);
+    static char mismatch[48];
+    size_t differing = differingPixels(golden, image);
+    if (differing == SIZE_MAX) snprintf(mismatch, sizeof(mismatch), "MISMATCH (size)");
+    else snprintf(mismatch, sizeof(mismatch), "MISMATCH (%zu px)", differing);
+    result = mismatch;
+    ok = false;
+  } else {
+    remove(actualPath.c_str());
+  }
+  printf("%-16s %9.1f us  %s\n", name, us, result);
+  return ok;
+}
+
+// Pixel (x, y) of a P4 image of the given width, past its header.
+static bool pbmPixel(const std::vector<uint8_t>& pbm, size_t header, int width, int x, int y) {
+  return pbm[header + y * ((width + 7) / 8) + x / 8] & (0x80 >> (x % 8));
+}
+
+/*
+ * All 256 moon phase steps, each rendered by updateDisplay() over the full
+ * moon's scenario, cropped to where the new and the full moon differ and
+ * tiled into one sheet. The crop holds only the moon, so the sheet does not
+ * depend on the fonts.
+*/
+static bool checkMoonPhases(Scenario s) {
+  const int W = GxEPD2_397_GDEM0397T81::WIDTH, H = GxEPD2_397_GDEM0397T81::HEIGHT;
+  std::vector<std::vector<uint8_t>> frames;
+  double totalUs = 0;
+  clearPanel();
+  for (int step = 0; step < MOON_STEPS; step++) {
+    s.moonPhase = (step + 0.5f) / MOON_STEPS;
+    auto start = std::chrono::steady_clock::now();
+    render(s);
+    totalUs += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    frames.push_back(panelPbm());
+  }
+
+  size_t header = frames[0].size() - W / 8 * H;
+  const std::vector<uint8_t>& newMoon = frames[0];
+  const std::vector<uint8_t>& fullMoon = frames[MOON_STEPS / 2];
+  int x1 = W, y1 = H, x2 = -1, y2 = -1;
+  for (int y = 0; y < H; y++) {
+    for (int x = 0; x < W; x++) {
+      if (pbmPixel(newMoon, header, W, x, y) == pbmPixel(fullMoon, header, W, x, y)) continue;
+      x1 = std::min(x1, x);
+      y1 = std::min(y1, y);
+      x2 = std::max(x2, x);
+      y2 = std::max(y2, y);
+    }
+  }
+  if (x2 < 0) {
+    printf("%-16s no moon drawn  MISMATCH\n", "moon_phases");
+    return false;
+  }
+
+  int tileW = x2 - x1 + 2, tileH = y2 - y1 + 2;
+  int sheetW = tileW * MOON_SHEET_COLUMNS, sheetH = tileH * (MOON_STEPS / MOON_SHEET_COLUMNS);
+  std::string sheetHeader = "P4\n" + std::to_string(sheetW) + " " + std::to_string(sheetH) + "\n";
+  std::vector<uint8_t> sheet(sheetHeader.begin(), sheetHeader.end());
+  size_t sheetStart = sheet.size();
+  sheet.resize(sheetStart + (sheetW + 7) / 8 * sheetH);
+  for (int step = 0; step < MOON_STEPS; step++) {
+    int tx = step % MOON_SHEET_COLUMNS * tileW, ty = step / MOON_SHEET_COLUMNS * tileH;
+    for (int y = y1; y <= y2; y++) {
+      for (int x = x1; x <= x2; x++) {
+        if (!pbmPixel(frames[step], header, W, x, y)) continue;
+        int sx = tx + x - x1, sy = ty + y - y1;
+        sheet[sheetStart + sy * ((sheetW + 7) / 8) + sx / 8] |= 0x80 >> (sx % 8);
+      }
+    }
+  }
+  return check("moon_phases", sheet, totalUs / MOON_STEPS);
+}
+
+int main() {
+  display.setRotation(2);
+
+  Scenario summer = scenario("summer", 24.0f, 6.0f, 1.5f);
+  Scenario frost = scenario("frost", -6.0f, 4.0f, 0.4f);
+  frost.tempAir = -7.5f;
+  Scenario deepFrost = scenario("deep_frost", -18.0f, 2.0f, 0.0f);
+  deepFrost.tempAir = -21.3f;
+  Scenario heavyRain = scenario("heavy_rain", 14.0f, 2.0f, 28.0f);
+  Scenario noWeather = summer;
+  noWeather.name = "no_weather";
+  noWeather.weatherValid = false;
+  Scenario notReady = summer;
+  notReady.name = "co2_not_ready";
+  notReady.co2 = -1.0f;
+  Scenario sensorErrors = summer;
+  sensorErrors.name = "sensor_errors";
+  sensorErrors.tempAir = sensorErrors.humidity = sensorErrors.pressure = sensorErrors.co2 = -3.0f;
+  Scenario midnight = summer;
+  midnight.name = "midnight_start";
+  midnight.startHour = 23;
+  Scenario scenarios[] = {summer, frost, deepFrost, heavyRain, noWeather, notReady, sensorErrors, midnight};
+
+  bool ok = true;
+  printf("%-16s %12s  %s\n", "scenario", "render", "golden");
+  for (const Scenario& s : scenarios) {
+    double us = renderUs(s);
+    clearPanel();
+    render(s);
+    ok &= check(s.name, panelPbm(), us, TEXT_GOLDENS);
+  }
+  ok &= checkMoonPhases(summer);
+  return ok ? 0 : 1;
+}
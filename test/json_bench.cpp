@@ -0,0 +1,117 @@
+// Host benchmark of the Open-Meteo forecast parse: buffered String +
+// full DOM (the old path), the filtered stream parse, and the FlatBuffers
+// response read in place.
+//   pio run -e bench_json -t exec
+#include <Arduino.h>
+#include <WiFi.h>
+#include <HTTPClient.h>
+#include <ArduinoJson.h>
+#include <chrono>
+#include <cstdio>
+#include "../src/forecast.h"
+#include "../include/config.h"
+
+// Peak heap is tracked by interposing glibc's allocator, so it counts the
+// payload String and the JsonDocument pool alike.
+#if defined(__GLIBC__)
+#include <malloc.h>
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t count, size_t size);
+extern "C" void* __libc_realloc(void* ptr, size_t size);
+extern "C" void __libc_free(void* ptr);
+
+static size_t heapInUse = 0, heapPeak = 0;
+
+static void heapAdd(void* ptr) {
+  if (!ptr) return;
+  heapInUse += malloc_usable_size(ptr);
+  if (heapInUse > heapPeak) heapPeak = heapInUse;
+}
+
+static void heapRemove(void* ptr) {
+  if (ptr) heapInUse -= malloc_usable_size(ptr);
+}
+
+extern "C" void* malloc(size_t size) { void* ptr = __libc_malloc(size); heapAdd(ptr); return ptr; }
+extern "C" void* calloc(size_t count, size_t size) { void* ptr = __libc_calloc(count, size); heapAdd(ptr); return ptr; }
+extern "C" void free(void* ptr) { heapRemove(ptr); __libc_free(ptr); }
+extern "C" void* realloc(void* ptr, size_t size) {
+  heapRemove(ptr);
+  void* grown = __libc_realloc(ptr, size);
+  heapAdd(grown ? grown : ptr);
+  return grown;
+}
+#define HEAP_TRACKED true
+#else
+static size_t heapInUse = 0, heapPeak = 0;
+#define HEAP_TRACKED false
+#endif
+
+const int ITERATIONS = 200;
+
+struct Result {
+  size_t peakBytes;
+  double parseUs;
+  bool ok;
+};
+
+static String forecastUrl(int hours) {
+  return "https://api.open-meteo.com/v1/forecast?latitude=50.06&longitude=14.419998&timezone=Europe%2FBerlin&forecast_days=" + String((hours + 23) / 24) + "&hourly=temperature_2m,rain,snowfall&daily=sunset,sunrise&forecast_hours=" + String(hours) + "&models=icon_d2";
+}
+
+static bool parseBuffered(HTTPClient& http, Forecast& forecast) {
+  String payload = http.getString();
+  JsonDocument doc;
+  if (deserializeJson(doc, payload)) return false;
+  return readForecast(doc, forecast);
+}
+
+static bool parseStreamed(HTTPClient& http, Forecast& forecast) {
+  return !parseForecast(http.getStream(), forecast);
+}
+
+static bool parseFlatBuffer(HTTPClient& http, Forecast& forecast) {
+  uint8_t buffer[4096];
+  int size = http.getSize();
+  if (size <= 0 || size > (int)sizeof(buffer)) return false;
+  http.getStream().readBytes(buffer, size);
+  return parseForecastFlatBuffer(buffer, size, forecast);
+}
+
+static Result run(int hours, bool (*parse)(HTTPClient&, Forecast&), const char* format = "") {
+  Result result = {0, 0, true};
+  for (int i = 0; i < ITERATIONS; i++) {
+    HTTPClient http;
+    http.useHTTP10(true);
+    http.begin(forecastUrl(hours) + format);
+    if (http.GET() != 200) return Result{0, 0, false};
+
+    Forecast forecast = {};
+    size_t before = heapInUse;
+    heapPeak = heapInUse;
+    auto start = std::chrono::steady_clock::now();
+    result.ok &= parse(http, forecast);
+    result.parseUs += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    result.peakBytes = max(result.peakBytes, heapPeak - before);
+    http.end();
+  }
+  result.parseUs /= ITERATIONS;
+  return result;
+}
+
+int main() {
+  WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
+  while (WiFi.status() != WL_CONNECTED) delay(50);
+
+  printf("%-6s %-10s %12s %12s\n", "hours", "path", "peak heap", "parse");
+  for (int hours : {24, 48}) {
+    Result buffered = run(hours, parseBuffered);
+    Result streamed = run(hours, parseStreamed);
+    Result flat = run(hours, parseFlatBuffer, "&format=flatbuffers");
+    printf("%-6d %-10s %10zu B %9.1f us%s\n", hours, "buffered", buffered.peakBytes, buffered.parseUs, buffered.ok ? "" : "  FAILED");
+    printf("%-6d %-10s %10zu B %9.1f us%s\n", hours, "streamed", streamed.peakBytes, streamed.parseUs, streamed.ok ? "" : "  FAILED");
+    printf("%-6d %-10s %10zu B %9.1f us%s\n", hours, "flatbuf", flat.peakBytes, flat.parseUs, flat.ok ? "" : "  FAILED");
+  }
+  if (!HEAP_TRACKED) printf("peak heap is only tracked with glibc\n");
+  return 0;
+}
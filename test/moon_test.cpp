@@ -0,0 +1,108 @@
+// Host check of the procedural moon against the 24 bitmaps it replaced. The
+// bitmaps are hand drawn and textured, so they are compared by shape: the
+// limb of the full moon, and per phase the terminator, the innermost lit
+// column of each band of rows. For every bitmap the phase step whose
+// terminator fits best must lie within two bitmap phases of the one it was
+// shown for.
+//   pio run -e test_moon -t exec
+#include <Arduino.h>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include "../src/rendering.h"
+#include "../src/framebuffer.h"
+#include "moon.icon.h"
+
+const int BOX = 64;
+const int BAND = 4;                 // rows, one dither period
+const float MAX_LIMB_ERROR = 1.5f;  // px, mean over the bands
+const int MAX_TERMINATOR_ERROR = 3; // px, mean over the bands, at the best fit
+const int MAX_PHASE_OFFSET = 2;     // bitmap phases of 1/24
+
+DisplayType display(GxEPD2_397_GDEM0397T81(-1, -1, -1, -1));
+
+static bool bitmapPixel(const uint8_t* bitmap, int x, int y) {
+  return bitmap[y * BOX / 8 + x / 8] & (0x80 >> (x % 8));
+}
+
+struct Moon {
+  bool pixels[BOX][BOX];
+};
+
+static Moon bitmapMoon(const uint8_t* bitmap) {
+  Moon moon;
+  for (int y = 0; y < BOX; y++) {
+    for (int x = 0; x < BOX; x++) moon.pixels[y][x] = bitmapPixel(bitmap, x, y);
+  }
+  return moon;
+}
+
+static Moon drawnMoon(uint8_t step) {
+  display.fillScreen(GxEPD_WHITE);
+  drawMoon(display, 0, 0, step);
+  FrameBuffer fb = frameBuffer(display);
+  Moon moon;
+  for (int y = 0; y < BOX; y++) {
+    for (int x = 0; x < BOX; x++) moon.pixels[y][x] = frameBufferPixel(fb, x, y);
+  }
+  return moon;
+}
+
+// First (fromLeft) or last lit column in the band of rows, -1 if it is dark.
+// Both moons are dithered, so a single row may miss the edge by a few px.
+static int edge(const Moon& moon, int band, bool fromLeft) {
+  for (int i = 0; i < BOX; i++) {
+    int x = fromLeft ? i : BOX - 1 - i;
+    for (int y = band * BAND; y < (band + 1) * BAND; y++) {
+      if (moon.pixels[y][x]) return x;
+    }
+  }
+  return -1;
+}
+
+// Mean distance of the terminators over the bands lit in either moon; a band
+// lit in one only counts as the whole lit width of the other.
+static float terminatorError(const Moon& a, const Moon& b, bool waxing) {
+  int total = 0, rows = 0;
+  for (int y = 0; y < BOX / BAND; y++) {
+    int ea = edge(a, y, waxing), eb = edge(b, y, waxing);
+    if (ea < 0 && eb < 0) continue;
+    if (ea < 0) ea = edge(b, y, !waxing);
+    if (eb < 0) eb = edge(a, y, !waxing);
+    total += abs(ea - eb);
+    rows++;
+  }
+  return rows ? float(total) / rows : 0;
+}
+
+int main() {
+  display.setRotation(2);
+  bool ok = true;
+
+  Moon fullBitmap = bitmapMoon(epd_bitmap_allArray[12]);
+  Moon full = drawnMoon(128);
+  float limbError = (terminatorError(fullBitmap, full, true) + terminatorError(fullBitmap, full, false)) / 2;
+  ok &= limbError <= MAX_LIMB_ERROR;
+  printf("full moon limb: %.2f px off%s\n\n", limbError, limbError <= MAX_LIMB_ERROR ? "" : "  FAIL");
+
+  printf("%-6s %6s %6s %10s %8s\n", "bitmap", "shown", "fit", "offset", "error");
+  for (int i = 0; i < epd_bitmap_allArray_LEN; i++) {
+    Moon bitmap = bitmapMoon(epd_bitmap_allArray[i]);
+    int shown = (i * 256 + 128) / 24;
+    bool waxing = shown < 128;
+    int bestStep = shown;
+    float bestError = 1e9f;
+    for (int step = waxing ? 0 : 128; step < (waxing ? 128 : 256); step++) {
+      float error = terminatorError(bitmap, drawnMoon(step), waxing);
+      if (error < bestError) {
+        bestError = error;
+        bestStep = step;
+      }
+    }
+    float offset = (bestStep - shown) * 24.0f / 256.0f;
+    bool pass = fabsf(offset) <= MAX_PHASE_OFFSET && bestError <= MAX_TERMINATOR_ERROR;
+    ok &= pass;
+    printf("%-6d %6d %6d %+10.2f %5.2f px%s\n", i, shown, bestStep, offset, bestError, pass ? "" : "  FAIL");
+  }
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,132 @@
+// Host test of the refresh policy: a day of wakes every 5 minutes through
+// planRefresh(), antiGhosting() and updateDisplay(), with the readings
+// drifting and the forecast moving on every hour. Checks that the first
+// update is a full refresh, that unchanged content is skipped, that the
+// ghosting budget is spent on region flashes and full refreshes, and that
+// the panel still ends up showing what a clean render shows, also after an
+// update that only redraws the temperature graph. Prints the
+// panel time against the fixed schedule it replaced: a full refresh with
+// every forecast fetch, otherwise two partial flashes of a strip.
+//   pio run -e test_refresh -t exec
+#include <Arduino.h>
+#include <GxEPD2_BW.h>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <sim_test.h>
+#include "../src/rendering.h"
+#include "../src/framebuffer.h"
+
+const int HOURS = 24;
+const int WAKES = 24 * 12;
+const int WAKES_PER_FORECAST = 12;
+
+DisplayType display(GxEPD2_397_GDEM0397T81(-1, -1, -1, -1));
+
+struct Readings {
+  float tempAir, humidity, co2, pressure;
+  float temp[HOURS], rain[HOURS];
+  int startHour;
+};
+
+static Readings readings(int wake) {
+  Readings r;
+  float t = wake / 12.0f;
+  r.tempAir = roundf(10 * (21.0f + 1.5f * sinf(t / 3))) / 10;
+  r.humidity = roundf(10 * (45.0f + 6.0f * sinf(t / 5))) / 10;
+  r.co2 = roundf(600 + 250 * sinf(t / 2) + (wake % 3) * 4);
+  r.pressure = roundf(1013 + 3 * sinf(t / 11));
+  r.startHour = (6 + wake / WAKES_PER_FORECAST) % 24;
+  for (int i = 0; i < HOURS; i++) {
+    float hour = r.startHour + i;
+    r.temp[i] = 14 + 6 * sinf((hour - 9) * 2 * float(M_PI) / 24);
+    float shower = 1 - fabsf(fmodf(hour, 24) - 15) / 4;
+    r.rain[i] = shower > 0 ? 2 * shower : 0;
+  }
+  return r;
+}
+
+static bool shows(const Readings& r) {
+  return displayUpToDate(r.tempAir, r.humidity, r.co2, r.pressure, "07:12", "19:48", r.temp, r.rain, HOURS, r.startHour, true, 0.3f);
+}
+
+static void update(const Readings& r) {
+  updateDisplay(display, r.tempAir, r.humidity, r.co2, r.pressure, "07:12", "19:48", r.temp, r.rain, HOURS, r.startHour, true, 0.3f);
+}
+
+static uint32_t panelMs() {
+  return sim::panel.fullRefreshes * sim::timing::EPD_FULL_REFRESH + sim::panel.partialRefreshes * sim::timing::EPD_PARTIAL_REFRESH;
+}
+
+int main() {
+  display.setRotation(2);
+  bool ok = true;
+
+  RefreshAction first = planRefresh(true);
+  ok &= sim::expect(first == REFRESH_FULL, "first update is a full refresh");
+  display.setFullWindow();
+  antiGhosting(display, first);
+  Readings r = readings(0);
+  update(r);
+  ok &= sim::expect(planRefresh(!shows(r)) == REFRESH_SKIP, "unchanged content is skipped");
+
+  // boxInk() against the per-pixel read of the same window.
+  FrameBuffer fb = frameBuffer(display);
+  uint32_t hash, pixels = 0;
+  for (int16_t y = 0; y < fb.height; y++) {
+    for (int16_t x = 0; x < fb.width; x++) pixels += frameBufferPixel(fb, x, y);
+  }
+  ok &= sim::expect(boxInk(fb, 0, fb.width - 1, 0, fb.height - 1, &hash) == pixels, "boxInk() counts the window's black pixels");
+
+  int counts[4] = {};
+  uint32_t startMs = panelMs(), fixedMs = 0;
+  int partialsSinceFull = 0, longestRun = 0;
+  for (int wake = 1; wake < WAKES; wake++) {
+    r = readings(wake);
+    bool fetch = wake % WAKES_PER_FORECAST == 0;
+    RefreshAction action = planRefresh(fetch || !shows(r));
+    counts[action]++;
+    if (action == REFRESH_SKIP) continue;
+
+    fixedMs += fetch ? sim::timing::EPD_FULL_REFRESH : 2 * sim::timing::EPD_PARTIAL_REFRESH;
+    fixedMs += sim::timing::EPD_PARTIAL_REFRESH;
+    display.setFullWindow();
+    antiGhosting(display, action);
+    update(r);
+    partialsSinceFull = action == REFRESH_FULL ? 0 : partialsSinceFull + 1;
+    longestRun = std::max(longestRun, partialsSinceFull);
+  }
+  uint32_t policyMs = panelMs() - startMs;
+
+  printf("\n%-10s %6s\n", "action", "wakes");
+  const char* names[] = {"skip", "partial", "regions", "full"};
+  for (int a = 0; a < 4; a++) printf("%-10s %6d\n", names[a], counts[a]);
+  printf("panel time %6.1f s, fixed schedule %6.1f s\n\n", policyMs / 1000.0, fixedMs / 1000.0);
+
+  ok &= sim::expect(counts[REFRESH_REGIONS] > 0, "ghosted regions are flashed");
+  ok &= sim::expect(counts[REFRESH_FULL] > 0 && counts[REFRESH_FULL] < WAKES / WAKES_PER_FORECAST, "full refreshes are rarer than hourly");
+  ok &= sim::expect(longestRun <= 72, "a full refresh follows at most 72 updates");
+  ok &= sim::expect(policyMs < fixedMs, "less panel time than the fixed schedule");
+
+  // The incrementally updated panel against a clean render of the last readings.
+  static uint8_t incremental[sizeof(sim::panel.pixels)];
+  memcpy(incremental, sim::panel.pixels, sizeof(incremental));
+  display.setFullWindow();
+  largeAntiGhosting(display);
+  update(r);
+  ok &= sim::expect(memcmp(incremental, sim::panel.pixels, sizeof(incremental)) == 0, "panel matches a clean render");
+
+  // Only the temperatures move, so only the graph region is redrawn: the
+  // thick curve at its highest and lowest points must stay inside it.
+  Readings shifted = r;
+  for (int i = 0; i < HOURS; i++) shifted.temp[i] = r.temp[(i + 7) % HOURS];
+  display.setFullWindow();
+  antiGhosting(display, REFRESH_PARTIAL);
+  update(shifted);
+  memcpy(incremental, sim::panel.pixels, sizeof(incremental));
+  display.setFullWindow();
+  largeAntiGhosting(display);
+  update(shifted);
+  ok &= sim::expect(memcmp(incremental, sim::panel.pixels, sizeof(incremental)) == 0, "a graph-only update leaves no curve pixels behind");
+  return ok ? 0 : 1;
+}
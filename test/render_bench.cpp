@@ -0,0 +1,289 @@
+// Host benchmark of the forecast graph drawing: the per-pixel loops and
+// GFX lines it replaced against the span fills, on the simulated GxEPD2
+// buffer. The trail, rain bars, icons and atlas text must produce identical
+// pixels; the thick curve is rasterized differently, so the pixels it
+// changes are counted.
+//   pio run -e bench_render -t exec
+#include <Arduino.h>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+#include "../src/rendering.h"
+#include "../src/framebuffer.h"
+#include "../src/glyphs.h"
+#include "glyph_atlas.h"
+#include <Fonts/FreeSansBold18pt7b.h>
+#include "../src/icons/temp.icon.h"
+#include "../src/icons/humidity.icon.h"
+#include "../src/icons/sunrise.icon.h"
+#include "../src/icons/sunset.icon.h"
+#include "../src/icons/co2.icon.h"
+#include "../src/icons/pressure.icon.h"
+
+const int ITERATIONS = 500;
+const int HOURS = 24;
+
+DisplayType display(GxEPD2_397_GDEM0397T81(-1, -1, -1, -1));
+
+// ######################### Per-pixel reference ###############################
+
+static const uint8_t referencePatterns[8][4] = {
+  {0b1111, 0b1111, 0b1111, 0b1111},
+  {0b1111, 0b0111, 0b1111, 0b1101},
+  {0b1010, 0b1111, 0b1010, 0b1111},
+  {0b1010, 0b0101, 0b1010, 0b0101},
+  {0b1010, 0b0000, 0b0101, 0b0000},
+  {0b1000, 0b0000, 0b0010, 0b0000},
+  {0b0000, 0b0100, 0b0000, 0b0000},
+  {0b0000, 0b0000, 0b0000, 0b0000},
+};
+
+static bool shouldDrawPixel(int x, int y, int ditherLevel) {
+  if (ditherLevel >= 8) return false;
+  if (ditherLevel < 0) ditherLevel = 0;
+  return (referencePatterns[ditherLevel][y % 4] >> (3 - x % 4)) & 1;
+}
+
+static void drawTrailPerPixel(DisplayType& display, int x, int y, int w, int h, const float* data, int dataSize, float minVal, float maxVal) {
+  float range = maxVal - minVal;
+  if (range <= 0.001f) range = 1.0f;
+  int zeroY = y + h - static_cast<int>(((0.0f - minVal) / range) * h);
+  bool zeroInRange = (zeroY >= y && zeroY <= y + h);
+  const int fadeDepth = 24;
+  const int fadeSteps = 8;
+
+  for (int i = 0; i < dataSize - 1; i++) {
+    int x1 = x + i * w / dataSize;
+    int x2 = x + (i + 1) * w / dataSize;
+    int lineY = y + h - static_cast<int>(((data[i] - minVal) / range) * h);
+    bool aboveZero = data[i] >= 0;
+    for (int px = x1; px < x2; px++) {
+      float t = static_cast<float>(px - x1) / static_cast<float>(x2 - x1);
+      int nextLineY = y + h - static_cast<int>(((data[i + 1] - minVal) / range) * h);
+      int currentY = lineY + static_cast<int>(t * (nextLineY - lineY));
+      currentY = std::max(y, std::min(y + h - 1, currentY));
+      if (aboveZero) {
+        int trailEnd = zeroInRange ? std::min(zeroY, y + h - 1) : y + h - 1;
+        trailEnd = std::min(trailEnd, currentY + fadeDepth);
+        for (int py = currentY + 3; py <= trailEnd; py++) {
+          if (shouldDrawPixel(px, py, ((py - currentY) * fadeSteps) / fadeDepth)) display.drawPixel(px, py, GxEPD_BLACK);
+        }
+      } else {
+        int trailEnd = zeroInRange ? std::max(zeroY, y) : y;
+        trailEnd = std::max(trailEnd, currentY - fadeDepth);
+        for (int py = currentY - 3; py >= trailEnd; py--) {
+          if (shouldDrawPixel(px, py, ((currentY - py) * fadeSteps) / fadeDepth)) display.drawPixel(px, py, GxEPD_BLACK);
+        }
+      }
+    }
+  }
+}
+
+static void drawGraphWithLines(DisplayType& display, int x, int y, int w, int h, const float* data, int dataSize, float minVal, float maxVal) {
+  float range = maxVal - minVal;
+  if (range <= 0.001f) range = 1.0f;
+  drawTrailPerPixel(display, x, y, w, h, data, dataSize, minVal, maxVal);
+
+  int firstLine = static_cast<int>(floor(minVal / 10.0f)) * 10;
+  for (int t = firstLine; t <= static_cast<int>(ceil(maxVal)); t += 10) {
+    int yy = y + h - static_cast<int>(((static_cast<float>(t) - minVal) / range) * h);
+    if (yy < y || yy > y + h) continue;
+    if (t == 0) {
+      display.drawLine(x + 1, yy - 1, x + w - 2, yy - 1, GxEPD_BLACK);
+      display.drawLine(x + 1, yy, x + w - 2, yy, GxEPD_BLACK);
+      display.drawLine(x + 1, yy + 1, x + w - 2, yy + 1, GxEPD_BLACK);
+    } else {
+      display.drawLine(x + 1, yy, x + w - 2, yy, GxEPD_BLACK);
+    }
+  }
+
+  for (int i = 1; i < dataSize; i++) {
+    int x1 = x + (i - 1) * w / dataSize;
+    int y1 = y + h - static_cast<int>(((data[i - 1] - minVal) / range) * h);
+    int x2 = x + i * w / dataSize;
+    int y2 = y + h - static_cast<int>(((data[i] - minVal) / range) * h);
+    for (int off = -2; off <= 2; off++) {
+      display.drawLine(x1, y1 + off, x2, y2 + off, GxEPD_BLACK);
+    }
+  }
+}
+
+static void drawRainWithRects(DisplayType& display, int x, int y, int w, int h, const float* data, int dataSize, float maxVal) {
+  int colWidth = std::max(1, w / dataSize);
+  for (int i = 0; i < dataSize; i++) {
+    if (data[i] <= 0) continue;
+    int colHeight = std::max(1, static_cast<int>((data[i] / maxVal) * h));
+    display.fillRect(x + i * colWidth, y + h - colHeight, colWidth - 1, colHeight, GxEPD_BLACK);
+  }
+}
+
+// ################################ Scenarios ##################################
+
+struct Scenario {
+  const char* name;
+  float temp[HOURS];
+  float rain[HOURS];
+  float minTemp, maxTemp, maxRain;
+};
+
+static Scenario makeScenario(const char* name, float mean, float swing) {
+  Scenario s;
+  s.name = name;
+  s.minTemp = s.maxTemp = mean;
+  s.maxRain = 1.0f;
+  for (int i = 0; i < HOURS; i++) {
+    s.temp[i] = mean + swing * sinf((i - 9) / 24.0f * 2.0f * static_cast<float>(M_PI));
+    s.rain[i] = std::max(0.0f, swing * 0.4f * sinf(i / 5.0f));
+    s.maxRain = std::max(s.maxRain, s.rain[i]);
+    s.minTemp = std::min(s.minTemp, s.temp[i]);
+    s.maxTemp = std::max(s.maxTemp, s.temp[i]);
+  }
+  s.minTemp = floor(s.minTemp);
+  s.maxTemp = ceil(s.maxTemp);
+  if (s.minTemp == s.maxTemp) { s.minTemp -= 1; s.maxTemp += 1; }
+  return s;
+}
+
+typedef void (*DrawFunction)(DisplayType&, int, int, int, int, const float*, int, float, float);
+typedef void (*RainFunction)(DisplayType&, int, int, int, int, const float*, int, float);
+
+static std::vector<uint8_t> snapshot() {
+  FrameBuffer fb = frameBuffer(display);
+  std::vector<uint8_t> pixels(fb.width * fb.height);
+  for (int16_t y = 0; y < fb.height; y++) {
+    for (int16_t x = 0; x < fb.width; x++) pixels[y * fb.width + x] = frameBufferPixel(fb, x, y);
+  }
+  return pixels;
+}
+
+static size_t differingPixels(const std::vector<uint8_t>& a, const std::vector<uint8_t>& b) {
+  size_t count = 0;
+  for (size_t i = 0; i < a.size(); i++) count += a[i] != b[i];
+  return count;
+}
+
+static double timeDraw(const Scenario& s, DrawFunction draw, std::vector<uint8_t>& pixels) {
+  double totalUs = 0;
+  for (int i = 0; i < ITERATIONS; i++) {
+    display.fillScreen(GxEPD_WHITE);
+    auto start = std::chrono::steady_clock::now();
+    draw(display, 4, 36, 792, 240, s.temp, HOURS, s.minTemp, s.maxTemp);
+    totalUs += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+  }
+  pixels = snapshot();
+  return totalUs / ITERATIONS;
+}
+
+static double timeRain(const Scenario& s, RainFunction draw, std::vector<uint8_t>& pixels) {
+  double totalUs = 0;
+  for (int i = 0; i < ITERATIONS; i++) {
+    display.fillScreen(GxEPD_WHITE);
+    auto start = std::chrono::steady_clock::now();
+    draw(display, 4, 276, 792, 80, s.rain, HOURS, s.maxRain);
+    totalUs += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+  }
+  pixels = snapshot();
+  return totalUs / ITERATIONS;
+}
+
+// The sensor strip's icons at their cell positions (the moon cell is left out).
+static const uint8_t* const STRIP_ICONS[] = {temp_icon_bits, epd_bitmap_humidity, epd_bitmap_sunrise, nullptr, epd_bitmap_sunset, epd_bitmap_co2, epd_bitmap_pressure};
+
+static double timeIcons(bool blit, std::vector<uint8_t>& pixels) {
+  double totalUs = 0;
+  for (int i = 0; i < ITERATIONS; i++) {
+    display.fillScreen(GxEPD_WHITE);
+    auto start = std::chrono::steady_clock::now();
+    FrameBuffer fb = frameBuffer(display);
+    for (int cell = 0; cell < 7; cell++) {
+      if (!STRIP_ICONS[cell]) continue;
+      int x = 51 + cell * 107 - 4;
+      if (blit) blitBitmap(fb, x, 366, STRIP_ICONS[cell], 64, 64);
+      else display.drawBitmap(x, 366, STRIP_ICONS[cell], 64, 64, GxEPD_BLACK);
+    }
+    totalUs += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+  }
+  pixels = snapshot();
+  return totalUs / ITERATIONS;
+}
+
+// The value row of the sensor strip, centred as drawCell() does.
+static const char* const STRIP_VALUES[] = {"21.4C", "48%", "07:12", " ", "19:48", "812", "1013"};
+
+static double timeValues(bool atlas, std::vector<uint8_t>& pixels) {
+  double totalUs = 0;
+  display.setFont(&FreeSansBold18pt7b);
+  display.setTextColor(GxEPD_BLACK);
+  for (int i = 0; i < ITERATIONS; i++) {
+    display.fillScreen(GxEPD_WHITE);
+    auto start = std::chrono::steady_clock::now();
+    FrameBuffer fb = frameBuffer(display);
+    for (int cell = 0; cell < 7; cell++) {
+      String v = STRIP_VALUES[cell];
+      int x = 51 + cell * 107 + 28;
+      int16_t tbx, tby; uint16_t tbw, tbh;
+      if (atlas) {
+        textBounds(FreeSansBold18pt7bAtlas, v, x, 442, &tbx, &tby, &tbw, &tbh);
+        drawText(fb, FreeSansBold18pt7bAtlas, x - tbw / 2, 442 + tbh / 2, v);
+      } else {
+        display.getTextBounds(v, x, 442, &tbx, &tby, &tbw, &tbh);
+        display.setCursor(x - tbw / 2, 442 + tbh / 2);
+        display.print(v);
+      }
+    }
+    totalUs += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+  }
+  pixels = snapshot();
+  return totalUs / ITERATIONS;
+}
+
+int main() {
+  display.setRotation(2);
+  Scenario scenarios[] = {
+    makeScenario("summer", 24.0f, 6.0f),
+    makeScenario("frost", -2.0f, 5.0f),
+    makeScenario("winter", -8.0f, 2.0f),
+    makeScenario("flat", 12.0f, 0.3f),
+  };
+
+  bool ok = true;
+  printf("%-8s %-6s %-10s %12s\n", "case", "part", "path", "draw");
+  for (const Scenario& s : scenarios) {
+    std::vector<uint8_t> reference, spans;
+    double perPixelUs = timeDraw(s, drawTrailPerPixel, reference);
+    double spanUs = timeDraw(s, drawForecastTrail, spans);
+    bool same = reference == spans;
+    ok &= same;
+    printf("%-8s %-6s %-10s %9.1f us\n", s.name, "trail", "per-pixel", perPixelUs);
+    printf("%-8s %-6s %-10s %9.1f us%s\n", s.name, "trail", "spans", spanUs, same ? "" : "  MISMATCH");
+
+    double linesUs = timeDraw(s, drawGraphWithLines, reference);
+    double filledUs = timeDraw(s, drawForecastGraph, spans);
+    printf("%-8s %-6s %-10s %9.1f us\n", s.name, "graph", "gfx lines", linesUs);
+    printf("%-8s %-6s %-10s %9.1f us  (%zu px differ)\n", s.name, "graph", "spans", filledUs, differingPixels(reference, spans));
+
+    double rectsUs = timeRain(s, drawRainWithRects, reference);
+    double boxesUs = timeRain(s, drawRainColumns, spans);
+    same = reference == spans;
+    ok &= same;
+    printf("%-8s %-6s %-10s %9.1f us\n", s.name, "rain", "gfx rects", rectsUs);
+    printf("%-8s %-6s %-10s %9.1f us%s\n", s.name, "rain", "spans", boxesUs, same ? "" : "  MISMATCH");
+  }
+
+  std::vector<uint8_t> reference, blitted;
+  double bitmapUs = timeIcons(false, reference);
+  double blitUs = timeIcons(true, blitted);
+  bool same = reference == blitted;
+  ok &= same;
+  printf("%-8s %-6s %-10s %9.1f us\n", "strip", "icons", "gfx bitmap", bitmapUs);
+  printf("%-8s %-6s %-10s %9.1f us%s\n", "strip", "icons", "blit", blitUs, same ? "" : "  MISMATCH");
+
+  double printUs = timeValues(false, reference);
+  double atlasUs = timeValues(true, blitted);
+  same = reference == blitted;
+  ok &= same;
+  printf("%-8s %-6s %-10s %9.1f us\n", "strip", "values", "gfx print", printUs);
+  printf("%-8s %-6s %-10s %9.1f us%s\n", "strip", "values", "atlas", atlasUs, same ? "" : "  MISMATCH");
+  return ok ? 0 : 1;
+}
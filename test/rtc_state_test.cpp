@@ -0,0 +1,72 @@
+// Host test of the RTC state: the forecast packing round trip, then the
+// firmware's wake cycle with a byte of rtc_state flipped between two
+// wakes, as a brownout could leave it. Checks that the next wake starts
+// over as on power-up (full refresh, forecast fetch, statistics of every
+// module) and that the wakes after it run normally again.
+//   pio run -e test_rtc_state -t exec
+#include <Arduino.h>
+#include <GxEPD2_BW.h>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sim_test.h>
+#include "../src/forecast.h"
+#include "../src/wake_budget.h"
+
+struct RtcState;
+extern RtcState rtc_state;
+
+int main() {
+  setenv("TZ", "UTC0", 1);
+  tzset();
+  bool ok = true;
+
+  Forecast forecast = {};
+  for (int i = 0; i < FORECAST_CACHE_HOURS; i++) {
+    forecast.temp[i] = -12.34f + i * 1.371f;
+    forecast.rain[i] = i * 1.26f;
+  }
+  strcpy(forecast.sunrise[0], "06:07");
+  strcpy(forecast.sunset[0], "--:--");
+  strcpy(forecast.sunrise[1], "06:08");
+  strcpy(forecast.sunset[1], "17:59");
+  forecast.startHour = 23;
+  forecast.startTimestamp = 1767222000;
+  forecast.hours = FORECAST_CACHE_HOURS;
+  PackedForecast packed;
+  packForecast(forecast, packed);
+  Forecast unpacked;
+  unpackForecast(packed, unpacked);
+  bool close = true;
+  for (int i = 0; i < FORECAST_CACHE_HOURS; i++) {
+    close &= fabsf(unpacked.temp[i] - forecast.temp[i]) <= 0.05f;
+    close &= fabsf(unpacked.rain[i] - std::min(forecast.rain[i], 25.5f)) <= 0.05f;
+  }
+  ok &= sim::expect(close, "temperature and rain within 0.05, rain saturates");
+  ok &= sim::expect(strcmp(unpacked.sunrise[0], "06:07") == 0 && strcmp(unpacked.sunset[0], "--:--") == 0
+    && strcmp(unpacked.sunrise[1], "06:08") == 0 && strcmp(unpacked.sunset[1], "17:59") == 0, "sunrise and sunset round trip");
+  ok &= sim::expect(unpacked.startHour == 23 && unpacked.startTimestamp == 1767222000 && unpacked.hours == FORECAST_CACHE_HOURS, "start of the forecast round trips");
+
+  // A stalled upload leaves a long worst wake in the budget statistics.
+  sim::runWake();
+  sim::setServerStallMs(20000);
+  for (int i = 0; i < 6; i++) sim::runWake();
+  sim::setServerStallMs(0);
+  uint32_t fulls = sim::panel.fullRefreshes;
+  sim::runWake();
+  ok &= sim::expect(sim::panel.fullRefreshes == fulls, "an intact state gives no full refresh");
+  uint32_t worstBefore = wakeBudgetSummary().substring(6).toInt();
+
+  reinterpret_cast<uint8_t*>(&rtc_state)[20] ^= 0x5A;
+  sim::runWake();
+  ok &= sim::expect(sim::panel.fullRefreshes == fulls + 1, "a corrupt state starts over with a full refresh");
+  ok &= sim::expect(sim::lastWakeAwakeUs() > 10000000, "...and the power-up wait for an upload");
+  uint32_t worstAfter = wakeBudgetSummary().substring(6).toInt();
+  ok &= sim::expect(worstAfter < worstBefore, "...and the wake budget statistics");
+
+  fulls = sim::panel.fullRefreshes;
+  for (int i = 0; i < 3; i++) sim::runWake();
+  ok &= sim::expect(sim::panel.fullRefreshes == fulls, "later wakes trust the state again");
+  return ok ? 0 : 1;
+}
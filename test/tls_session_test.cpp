@@ -0,0 +1,171 @@
+// Host test of the saved TLS session against the real mbedTLS 2.28, the
+// version in the ESP32 Arduino core, rather than the simulator's shim. A
+// client set up like ResumableTlsClient's handshakes over an in-memory
+// loopback with a server that sends a certificate chain and issues
+// session tickets. Checks that the session as mbedTLS would save it does
+// not fit TLS_SESSION_MAX_BYTES because of the certificate, that the one
+// tlsSessionSave() keeps does, and that it resumes the next handshake.
+// Needs the mbedTLS headers and libraries on the host (libmbedtls-dev).
+//   pio run -e test_tls_session -t exec
+#include <mbedtls/ssl.h>
+#include <mbedtls/ssl_ticket.h>
+#include <mbedtls/entropy.h>
+#include <mbedtls/ctr_drbg.h>
+#include <mbedtls/certs.h>
+#include <mbedtls/x509_crt.h>
+#include <mbedtls/pk.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include "../sim/include/sim_test.h"
+#include "../src/tls_session.h"
+
+const char* HOST = "api.open-meteo.com";
+
+// One direction of the loopback.
+struct Pipe {
+  std::deque<unsigned char> bytes;
+};
+
+struct Endpoint {
+  Pipe* in;
+  Pipe* out;
+};
+
+static int pipeSend(void* context, const unsigned char* buffer, size_t length) {
+  Endpoint* endpoint = static_cast<Endpoint*>(context);
+  endpoint->out->bytes.insert(endpoint->out->bytes.end(), buffer, buffer + length);
+  return static_cast<int>(length);
+}
+
+static int pipeReceive(void* context, unsigned char* buffer, size_t length) {
+  Endpoint* endpoint = static_cast<Endpoint*>(context);
+  if (endpoint->in->bytes.empty()) return MBEDTLS_ERR_SSL_WANT_READ;
+  size_t count = std::min(length, endpoint->in->bytes.size());
+  std::copy(endpoint->in->bytes.begin(), endpoint->in->bytes.begin() + count, buffer);
+  endpoint->in->bytes.erase(endpoint->in->bytes.begin(), endpoint->in->bytes.begin() + count);
+  return static_cast<int>(count);
+}
+
+// Tickets the server accepted, i.e. handshakes it resumed.
+static int ticketsAccepted = 0;
+
+static int parseTicket(void* context, mbedtls_ssl_session* session, unsigned char* buffer, size_t length) {
+  int ret = mbedtls_ssl_ticket_parse(context, session, buffer, length);
+  if (ret == 0) ticketsAccepted++;
+  return ret;
+}
+
+// Server with the mbedTLS test certificate and its CA as the chain, and a
+// ticket key, shared by every connection.
+struct Server {
+  mbedtls_ssl_config conf;
+  mbedtls_x509_crt chain;
+  mbedtls_pk_context key;
+  mbedtls_ssl_ticket_context ticket;
+};
+
+static bool setupServer(Server& server, mbedtls_ctr_drbg_context& drbg) {
+  mbedtls_ssl_config_init(&server.conf);
+  mbedtls_x509_crt_init(&server.chain);
+  mbedtls_pk_init(&server.key);
+  mbedtls_ssl_ticket_init(&server.ticket);
+  if (mbedtls_x509_crt_parse(&server.chain, reinterpret_cast<const unsigned char*>(mbedtls_test_srv_crt), mbedtls_test_srv_crt_len) != 0) return false;
+  if (mbedtls_x509_crt_parse(&server.chain, reinterpret_cast<const unsigned char*>(mbedtls_test_ca_crt), mbedtls_test_ca_crt_len) != 0) return false;
+  if (mbedtls_pk_parse_key(&server.key, reinterpret_cast<const unsigned char*>(mbedtls_test_srv_key), mbedtls_test_srv_key_len, nullptr, 0) != 0) return false;
+  if (mbedtls_ssl_config_defaults(&server.conf, MBEDTLS_SSL_IS_SERVER, MBEDTLS_SSL_TRANSPORT_STREAM, MBEDTLS_SSL_PRESET_DEFAULT) != 0) return false;
+  mbedtls_ssl_conf_rng(&server.conf, mbedtls_ctr_drbg_random, &drbg);
+  if (mbedtls_ssl_conf_own_cert(&server.conf, &server.chain, &server.key) != 0) return false;
+  if (mbedtls_ssl_ticket_setup(&server.ticket, mbedtls_ctr_drbg_random, &drbg, MBEDTLS_CIPHER_AES_256_GCM, 86400) != 0) return false;
+  mbedtls_ssl_conf_session_tickets_cb(&server.conf, mbedtls_ssl_ticket_write, parseTicket, &server.ticket);
+  return true;
+}
+
+// The client side as ResumableTlsClient::handshake() configures it.
+static bool setupClient(mbedtls_ssl_config& conf, mbedtls_ctr_drbg_context& drbg) {
+  mbedtls_ssl_config_init(&conf);
+  if (mbedtls_ssl_config_defaults(&conf, MBEDTLS_SSL_IS_CLIENT, MBEDTLS_SSL_TRANSPORT_STREAM, MBEDTLS_SSL_PRESET_DEFAULT) != 0) return false;
+  mbedtls_ssl_conf_authmode(&conf, MBEDTLS_SSL_VERIFY_NONE);
+  mbedtls_ssl_conf_rng(&conf, mbedtls_ctr_drbg_random, &drbg);
+  mbedtls_ssl_conf_session_tickets(&conf, MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
+  return true;
+}
+
+// One connection: handshakes with `saved` offered if given, then saves the
+// session the client ends up with. Returns whether the handshake resumed,
+// -1 if it failed. `fullLength` gets the size of mbedTLS's own save.
+static int connect(const mbedtls_ssl_config& clientConf, Server& server, const unsigned char* saved, size_t savedLength,
+                   unsigned char* session, size_t* sessionLength, size_t* fullLength) {
+  Pipe toServer, toClient;
+  Endpoint clientEnd{&toClient, &toServer}, serverEnd{&toServer, &toClient};
+  mbedtls_ssl_context client, serverSsl;
+  mbedtls_ssl_init(&client);
+  mbedtls_ssl_init(&serverSsl);
+  int result = -1, accepted = ticketsAccepted;
+  if (mbedtls_ssl_setup(&client, &clientConf) == 0 && mbedtls_ssl_setup(&serverSsl, &server.conf) == 0
+      && mbedtls_ssl_set_hostname(&client, HOST) == 0) {
+    mbedtls_ssl_set_bio(&client, &clientEnd, pipeSend, pipeReceive, nullptr);
+    mbedtls_ssl_set_bio(&serverSsl, &serverEnd, pipeSend, pipeReceive, nullptr);
+    if (saved) {
+      mbedtls_ssl_session offered;
+      mbedtls_ssl_session_init(&offered);
+      if (mbedtls_ssl_session_load(&offered, saved, savedLength) == 0) mbedtls_ssl_set_session(&client, &offered);
+      mbedtls_ssl_session_free(&offered);
+    }
+
+    // Each side runs until it waits for the other.
+    int clientRet = MBEDTLS_ERR_SSL_WANT_READ, serverRet = MBEDTLS_ERR_SSL_WANT_READ;
+    for (int round = 0; round < 64 && (clientRet != 0 || serverRet != 0); round++) {
+      if (clientRet != 0) clientRet = mbedtls_ssl_handshake(&client);
+      if (serverRet != 0) serverRet = mbedtls_ssl_handshake(&serverSsl);
+      bool clientWaits = clientRet == 0 || clientRet == MBEDTLS_ERR_SSL_WANT_READ || clientRet == MBEDTLS_ERR_SSL_WANT_WRITE;
+      bool serverWaits = serverRet == 0 || serverRet == MBEDTLS_ERR_SSL_WANT_READ || serverRet == MBEDTLS_ERR_SSL_WANT_WRITE;
+      if (!clientWaits || !serverWaits) break;
+    }
+
+    if (clientRet == 0 && serverRet == 0) {
+      result = ticketsAccepted > accepted ? 1 : 0;
+      mbedtls_ssl_session full;
+      mbedtls_ssl_session_init(&full);
+      static unsigned char fullBuffer[8192];
+      *fullLength = 0;
+      if (mbedtls_ssl_get_session(&client, &full) == 0) mbedtls_ssl_session_save(&full, fullBuffer, sizeof(fullBuffer), fullLength);
+      mbedtls_ssl_session_free(&full);
+      *sessionLength = 0;
+      if (tlsSessionSave(&client, session, TLS_SESSION_MAX_BYTES, sessionLength) != 0) *sessionLength = 0;
+    }
+  }
+  mbedtls_ssl_free(&client);
+  mbedtls_ssl_free(&serverSsl);
+  return result;
+}
+
+int main() {
+  mbedtls_entropy_context entropy;
+  mbedtls_ctr_drbg_context drbg;
+  mbedtls_entropy_init(&entropy);
+  mbedtls_ctr_drbg_init(&drbg);
+  Server server;
+  mbedtls_ssl_config clientConf;
+  bool ready = mbedtls_ctr_drbg_seed(&drbg, mbedtls_entropy_func, &entropy, nullptr, 0) == 0
+    && setupServer(server, drbg) && setupClient(clientConf, drbg);
+  if (!sim::expect(ready, "server and client set up")) return 1;
+
+  bool ok = true;
+  unsigned char session[TLS_SESSION_MAX_BYTES], resumedSession[TLS_SESSION_MAX_BYTES], lastSession[TLS_SESSION_MAX_BYTES];
+  size_t sessionLength = 0, resumedLength = 0, lastLength = 0, fullLength = 0, ignored = 0;
+  int first = connect(clientConf, server, nullptr, 0, session, &sessionLength, &fullLength);
+  int second = connect(clientConf, server, session, sessionLength, resumedSession, &resumedLength, &ignored);
+  int third = connect(clientConf, server, resumedSession, resumedLength, lastSession, &lastLength, &ignored);
+  printf("session as mbedTLS saves it: %zu bytes, as kept: %zu bytes (max %d)\n\n", fullLength, sessionLength, TLS_SESSION_MAX_BYTES);
+
+  ok &= sim::expect(first == 0, "first connect does a full handshake");
+  #if defined(MBEDTLS_SSL_KEEP_PEER_CERTIFICATE)
+    ok &= sim::expect(fullLength > TLS_SESSION_MAX_BYTES, "with the certificate the session would not fit");
+  #endif
+  ok &= sim::expect(sessionLength > 0 && sessionLength <= TLS_SESSION_MAX_BYTES, "the kept session fits");
+  ok &= sim::expect(second == 1, "next connect resumes from it");
+  ok &= sim::expect(resumedLength > 0 && third == 1, "...and so does the one after, from the resumed session");
+  return ok ? 0 : 1;
+}
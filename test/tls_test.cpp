@@ -0,0 +1,80 @@
+// Host test of the TLS session cache against the simulator's stand-in
+// server: a full handshake, then resumed ones from the session kept in RTC
+// memory, and the fallbacks when the server has rotated its ticket key, the
+// ticket has expired, or the server aborts on it. Checks that a slow
+// server's handshake gets the connect timeout rather than the stream's, and
+// reads a forecast through HTTPClient to check the data path.
+//   pio run -e test_tls -t exec
+#include <Arduino.h>
+#include <WiFi.h>
+#include <HTTPClient.h>
+#include <cstdio>
+#include <sim_test.h>
+#include "../src/tls_client.h"
+
+const char* HOST = "api.open-meteo.com";
+const char* OTHER_HOST = "api.thingspeak.com";
+const char* URL = "https://api.open-meteo.com/v1/forecast?latitude=50.06&longitude=14.419998&timezone=Europe%2FBerlin&forecast_days=1&hourly=temperature_2m,rain,snowfall&daily=sunset,sunrise&forecast_hours=24&models=icon_d2";
+
+ResumableTlsClient client;
+
+// Connects and reports whether the handshake was resumed, -1 if it failed.
+static int connectResumed(const char* host) {
+  sim::TlsServer& server = sim::tlsServer(host);
+  uint32_t resumed = server.resumedHandshakes;
+  int ok = client.connect(host, 443);
+  client.stop();
+  if (!ok) return -1;
+  return server.resumedHandshakes > resumed ? 1 : 0;
+}
+
+int main() {
+  WiFi.begin("ssid", "password");
+  while (!WiFi.isConnected()) delay(10);
+  bool ok = true;
+  sim::TlsServer& server = sim::tlsServer(HOST);
+
+  ok &= sim::expect(connectResumed(HOST) == 0, "first connect does a full handshake");
+  ok &= sim::expect(connectResumed(HOST) == 1, "next connect resumes");
+  ok &= sim::expect(connectResumed(OTHER_HOST) == 0, "session is not offered to another host");
+  ok &= sim::expect(connectResumed(OTHER_HOST) == 1, "...which then has its own session");
+  ok &= sim::expect(connectResumed(HOST) == 0, "only the last host's session is kept");
+
+  server.ticketKey++;
+  ok &= sim::expect(connectResumed(HOST) == 0, "rotated ticket key falls back to full");
+  ok &= sim::expect(connectResumed(HOST) == 1, "...and the new ticket resumes");
+
+  sim::advanceMs(server.ticketLifetimeS * 1000 + 1000);
+  ok &= sim::expect(connectResumed(HOST) == 0, "expired ticket falls back to full");
+
+  server.abortOnTicket = true;
+  uint32_t full = server.fullHandshakes;
+  ok &= sim::expect(connectResumed(HOST) == 0 && server.fullHandshakes == full + 1, "aborted resumption is retried in full");
+  server.abortOnTicket = false;
+
+  tlsSessionClear();
+  ok &= sim::expect(connectResumed(HOST) == 0, "cleared session does a full handshake");
+
+  // Past the 1 s stream timeout, within the connect timeout.
+  server.flightDelayMs = 2500;
+  ok &= sim::expect(client.connect(HOST, 443, 5000) == 1, "slow handshake waits for the connect timeout");
+  client.stop();
+  ok &= sim::expect(client.connect(HOST, 443, 2000) == 0, "...and gives up after it");
+  client.stop();
+  server.flightDelayMs = 0;
+
+  // The forecast through HTTPClient, as main.cpp fetches it.
+  HTTPClient http;
+  http.useHTTP10(true);
+  http.begin(client, URL);
+  int status = http.GET();
+  String body;
+  while (client.available() > 0) body += char(client.read());
+  http.end();
+  ok &= sim::expect(status == 200, "HTTP GET over the client");
+  ok &= sim::expect(body.startsWith("{") && body.indexOf("\"hourly\"") > 0, "body is read through the client");
+  ok &= sim::expect(server.resumedHandshakes > 0, "...on a resumed session");
+
+  printf("\n%s: %u full, %u resumed handshakes\n", HOST, unsigned(server.fullHandshakes), unsigned(server.resumedHandshakes));
+  return ok ? 0 : 1;
+}
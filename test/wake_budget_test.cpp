@@ -0,0 +1,52 @@
+// Host test of the wake budget: runs the firmware's wake cycle for eight
+// hours, with every HTTP server stalling for 20 s in the second hour, the
+// AP gone in the third and every TCP connect stalling in the seventh, when
+// the forecast is due again. Checks that no wake runs past the budget by
+// more than the last panel refresh, and that the readings that could not
+// go out during the stall are uploaded afterwards.
+//   pio run -e test_wake_budget -t exec
+#include <Arduino.h>
+#include <cstdio>
+#include <cstdlib>
+#include <sim_test.h>
+#include "../src/wake_budget.h"
+
+const int WAKES_PER_HOUR = 12;
+const int WAKES = 8 * WAKES_PER_HOUR;
+const uint32_t SERVER_STALL_MS = 20000;
+
+int main() {
+  setenv("TZ", "UTC0", 1);
+  tzset();
+
+  uint64_t worstNormalUs = 0, worstStallUs = 0, worstOfflineUs = 0, worstConnectUs = 0;
+  for (int wake = 0; wake < WAKES; wake++) {
+    int hour = wake / WAKES_PER_HOUR;
+    sim::setServerStallMs(hour == 1 ? SERVER_STALL_MS : 0);
+    sim::setAccessPointUp(hour != 2);
+    sim::setConnectStallMs(hour == 6 ? SERVER_STALL_MS : 0);
+    sim::runWake();
+    if (wake == 0) continue; // the cold boot waits for an upload window
+
+    uint64_t awakeUs = sim::lastWakeAwakeUs();
+    uint64_t& worst = hour == 1 ? worstStallUs : hour == 2 ? worstOfflineUs : hour == 6 ? worstConnectUs : worstNormalUs;
+    worst = std::max(worst, awakeUs);
+  }
+
+  printf("worst wake: %.1f ms normal, %.1f ms server stalled, %.1f ms AP down, %.1f ms connect stalled\n",
+    worstNormalUs / 1000.0, worstStallUs / 1000.0, worstOfflineUs / 1000.0, worstConnectUs / 1000.0);
+  printf("readings uploaded: %u of %d\n\n", sim::uploadedReadings(), WAKES);
+
+  // The display refresh started within budget is let finish.
+  const uint64_t limitUs = uint64_t(WAKE_BUDGET_MS + sim::timing::EPD_FULL_REFRESH) * 1000;
+  bool ok = true;
+  ok &= sim::expect(worstNormalUs <= uint64_t(WAKE_BUDGET_MS) * 1000, "normal wakes are within budget");
+  ok &= sim::expect(worstStallUs <= limitUs, "a stalled server does not run the wake over");
+  ok &= sim::expect(worstOfflineUs <= limitUs, "a missing AP does not run the wake over");
+  // The panel is done long before a stalled upload connect would give up,
+  // so that wake has no refresh to let finish.
+  ok &= sim::expect(worstConnectUs <= uint64_t(WAKE_BUDGET_MS + 100) * 1000, "a stalled connect does not run the wake over");
+  // All but the readings of the last, not yet due, batch.
+  ok &= sim::expect(sim::uploadedReadings() >= uint32_t(WAKES - 6), "readings held back during the stalls go out later");
+  return ok ? 0 : 1;
+}
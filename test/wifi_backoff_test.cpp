@@ -0,0 +1,80 @@
+// Host test of the WiFi backoff: runs the firmware's wake cycle for two
+// days against an access point that drops out. There is a 2.5 h outage, an
+// afternoon where it only answers every other wake, and an 8 h outage
+// overnight. Checks that a dead AP costs at most one short connect attempt
+// per hour once backed off, that no wake keeps the radio on past the
+// connect timeout plus the transfers, that readings queued during an
+// outage of up to 3 h all reach ThingSpeak, that the radio is back within
+// one backoff step after the AP returns, and that wakes without the radio
+// light-sleep through the CO2 conversion.
+//   pio run -e test_wifi_backoff -t exec
+#include <Arduino.h>
+#include <cstdio>
+#include <cstdlib>
+#include <sim_test.h>
+#include "../src/wifi_health.h"
+
+const int WAKES_PER_HOUR = 12;
+const int WAKES = 48 * WAKES_PER_HOUR;
+
+// AP state per wake: a 2.5 h outage from 04:00, a flaky afternoon from
+// 14:00 to 17:00 and 8 h down from 22:00.
+static bool apUp(int wake) {
+  float hour = float(wake) / WAKES_PER_HOUR;
+  if (hour >= 4 && hour < 6.5f) return false;
+  if (hour >= 14 && hour < 17) return wake % 2 == 0;
+  if (hour >= 22 && hour < 30) return false;
+  return true;
+}
+
+int main() {
+  setenv("TZ", "UTC0", 1);
+  tzset();
+
+  uint64_t worstRadioUs = 0, worstDownRadioUs = 0;
+  uint64_t downRadioUs = 0, upRadioUs = 0;
+  double worstRadioOffMc = 0;
+  int downWakes = 0, upWakes = 0, attemptsInLongOutage = 0, wakesToRecover = -1;
+  uint32_t uploadedBeforeLongOutage = 0;
+  for (int wake = 0; wake < WAKES; wake++) {
+    sim::setAccessPointUp(apUp(wake));
+    sim::runWake();
+    if (wake == 0) continue; // the cold boot waits for an upload window
+
+    uint64_t radioUs = sim::lastWakeRadioUs();
+    worstRadioUs = std::max(worstRadioUs, radioUs);
+    if (radioUs == 0) worstRadioOffMc = std::max(worstRadioOffMc, sim::lastWakeChargeMc());
+    if (apUp(wake)) {
+      upRadioUs += radioUs;
+      upWakes++;
+    } else {
+      downRadioUs += radioUs;
+      downWakes++;
+      worstDownRadioUs = std::max(worstDownRadioUs, radioUs);
+    }
+    // Hours 23 to 30 of the overnight outage, after the backoff has ramped up.
+    if (wake >= 23 * WAKES_PER_HOUR && wake < 30 * WAKES_PER_HOUR && radioUs > 0) attemptsInLongOutage++;
+    if (wake == 22 * WAKES_PER_HOUR - 1) uploadedBeforeLongOutage = sim::uploadedReadings();
+    if (wake >= 30 * WAKES_PER_HOUR && wakesToRecover < 0 && wifiHealth().failures == 0) {
+      wakesToRecover = wake - 30 * WAKES_PER_HOUR + 1;
+    }
+  }
+
+  printf("radio per wake, AP up   %8.1f ms over %d wakes\n", upRadioUs / 1000.0 / upWakes, upWakes);
+  printf("radio per wake, AP down %8.1f ms over %d wakes\n", downRadioUs / 1000.0 / downWakes, downWakes);
+  printf("worst wake              %8.1f ms, %.1f ms with the AP down\n", worstRadioUs / 1000.0, worstDownRadioUs / 1000.0);
+  printf("worst wake with the radio off: %.1f mC\n", worstRadioOffMc);
+  printf("attempts in 7 h of the overnight outage: %d, back after %d wakes\n\n", attemptsInLongOutage, wakesToRecover);
+
+  bool ok = true;
+  ok &= sim::expect(attemptsInLongOutage <= 8, "backed off to one attempt an hour");
+  ok &= sim::expect(worstDownRadioUs <= uint64_t(WIFI_TIMEOUT_MAX_MS) * 1000, "a dead AP costs no more than the connect timeout");
+  ok &= sim::expect(worstRadioUs <= uint64_t(WIFI_TIMEOUT_MAX_MS + 5000) * 1000, "no wake keeps the radio on past timeout + transfers");
+  // Busy-waiting through the 5 s CO2 conversion alone would take 120 mC.
+  ok &= sim::expect(worstRadioOffMc < 150, "wakes with the radio off light-sleep through the conversion");
+  ok &= sim::expect(downRadioUs < 3 * downWakes * 1000000ULL / 2, "under 1.5 s of radio per wake while the AP is down");
+  // Every reading up to the long outage but the last batch, which is still queued.
+  ok &= sim::expect(uploadedBeforeLongOutage >= 22 * WAKES_PER_HOUR - 6, "2.5 h and flaky outages lose no readings");
+  ok &= sim::expect(wakesToRecover > 0 && wakesToRecover <= WIFI_BACKOFF_MAX_S / 300 + 1, "reconnects within one backoff step");
+  return ok ? 0 : 1;
+}
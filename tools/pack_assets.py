@@ -0,0 +1,178 @@
+# Generates the compressed drawing assets, for blitPackedBitmap():
+#   glyph_atlas.h  the characters the display renders, cut out of the
+#                  Adafruit GFX fonts with byte-aligned rows
+#   icons.h        the icon bitmaps of src/icons
+# Every bitmap is PackBits compressed on its own.
+#
+# As a PlatformIO pre-script it reads the fonts of the env's Adafruit GFX
+# Library and writes the headers into the build directory. Standalone:
+#   python3 tools/pack_assets.py <Fonts dir> <icons dir> <output dir>
+import glob
+import os
+import re
+import sys
+
+FONTS = ["FreeSansBold18pt7b", "FreeSans18pt7b", "FreeSans12pt7b"]
+CHARACTERS = " -.0123456789:%C"
+
+
+def strip_comments(source):
+    source = re.sub(r"/\*.*?\*/", "", source, flags=re.S)
+    return re.sub(r"//[^\n]*", "", source)
+
+
+def numbers(text):
+    return [int(n, 0) for n in re.findall(r"-?(?:0x[0-9A-Fa-f]+|\d+)", text)]
+
+
+def read_font(path, name):
+    with open(path) as f:
+        source = strip_comments(f.read())
+    bitmap = numbers(re.search(name + r"Bitmaps\[\][^=]*=\s*\{(.*?)\};", source, re.S).group(1))
+    glyph_block = re.search(name + r"Glyphs\[\][^=]*=\s*\{(.*)\};", source, re.S).group(1)
+    glyph_block = glyph_block[: glyph_block.index("};")] if "};" in glyph_block else glyph_block
+    glyphs = [numbers(g) for g in re.findall(r"\{([^{}]*)\}", glyph_block)]
+    font = re.search(r"GFXfont\s+" + name + r"[^=]*=\s*\{(.*?)\};", source, re.S).group(1)
+    first, last, y_advance = numbers(font.split(",", 2)[2])
+    return bitmap, glyphs, first, last, y_advance
+
+
+def packbits(data):
+    """Header n < 128: n + 1 literal bytes follow. n > 128: the next byte
+    repeats 257 - n times. Runs of 3 or more are worth a repeat."""
+    out = []
+    literal = []
+    i = 0
+    while i < len(data):
+        run = 1
+        while i + run < len(data) and data[i + run] == data[i] and run < 128:
+            run += 1
+        if run >= 3 or (run == 2 and not literal):
+            if literal:
+                out.append(len(literal) - 1)
+                out.extend(literal)
+                literal = []
+            out.append(257 - run)
+            out.append(data[i])
+            i += run
+            continue
+        literal.extend(data[i : i + run])
+        i += run
+        while len(literal) >= 128:
+            out.append(127)
+            out.extend(literal[:128])
+            literal = literal[128:]
+    if literal:
+        out.append(len(literal) - 1)
+        out.extend(literal)
+    return out
+
+
+def unpackbits(packed, size):
+    out = []
+    i = 0
+    while len(out) < size:
+        n = packed[i]
+        if n < 128:
+            out.extend(packed[i + 1 : i + 2 + n])
+            i += 2 + n
+        elif n > 128:
+            out.extend([packed[i + 1]] * (257 - n))
+            i += 2
+        else:
+            i += 1
+    return out
+
+
+def byte_array(name, data, comment):
+    lines = ["// " + comment, "const uint8_t %s[] PROGMEM = {" % name]
+    for i in range(0, len(data), 16):
+        lines.append("  " + ", ".join("0x%02x" % b for b in data[i : i + 16]) + ",")
+    lines.append("};")
+    return lines
+
+
+def byte_rows(bitmap, offset, width, height):
+    """GFX glyphs are one bit stream; split it into rows padded to bytes."""
+    rows = []
+    bit = 0
+    for _ in range(height):
+        row = [0] * ((width + 7) // 8)
+        for x in range(width):
+            if bitmap[offset + bit // 8] & (0x80 >> (bit % 8)):
+                row[x // 8] |= 0x80 >> (x % 8)
+            bit += 1
+        rows.extend(row)
+    return rows
+
+
+def atlas(fonts_dir):
+    out = [
+        "// Generated by tools/pack_assets.py from the Adafruit GFX fonts, do not edit.",
+        "#pragma once",
+        '#include "glyphs.h"',
+        "",
+    ]
+    for name in FONTS:
+        bitmap, glyphs, first, last, y_advance = read_font(os.path.join(fonts_dir, name + ".h"), name)
+        data = []
+        entries = []
+        raw = 0
+        for c in CHARACTERS:
+            offset, width, height, x_advance, x_offset, y_offset = glyphs[ord(c) - first]
+            entries.append("  {%d, %d, %d, %d, %d, %d, %d}," % (ord(c), len(data), width, height, x_advance, x_offset, y_offset))
+            rows = byte_rows(bitmap, offset, width, height)
+            packed = packbits(rows)
+            assert unpackbits(packed, len(rows)) == rows
+            data.extend(packed)
+            raw += len(rows)
+        out.extend(byte_array(name + "AtlasBitmap", data, "%d bytes, %d unpacked" % (len(data), raw)))
+        out.append("const AtlasGlyph %sAtlasGlyphs[] = {" % name)
+        out.extend(entries)
+        out.append("};")
+        out.append("const GlyphAtlas %sAtlas = {%sAtlasBitmap, %sAtlasGlyphs, %d, %d};" % (name, name, name, len(CHARACTERS), y_advance))
+        out.append("")
+    return "\n".join(out)
+
+
+def icons(icons_dir):
+    out = [
+        "// Generated by tools/pack_assets.py from src/icons, do not edit.",
+        "#pragma once",
+        "#include <Arduino.h>",
+        "",
+    ]
+    for path in sorted(glob.glob(os.path.join(icons_dir, "*.icon.h"))):
+        with open(path) as f:
+            source = strip_comments(f.read())
+        for name, body in re.findall(r"const\s+unsigned\s+char\s+(\w+)\s*\[\]\s*(?:PROGMEM)?\s*=\s*\{(.*?)\};", source, re.S):
+            data = numbers(body)
+            packed = packbits(data)
+            assert unpackbits(packed, len(data)) == data
+            out.extend(byte_array(name + "_packed", packed, "%s: %d bytes, %d unpacked" % (os.path.basename(path), len(packed), len(data))))
+            out.append("")
+    return "\n".join(out)
+
+
+def write_if_changed(path, text):
+    if os.path.exists(path):
+        with open(path) as f:
+            if f.read() == text:
+                return
+    os.makedirs(os.path.dirname(path), exist_ok=True)
+    with open(path, "w") as f:
+        f.write(text)
+
+
+try:
+    Import("env")
+except NameError:
+    if __name__ == "__main__":
+        write_if_changed(os.path.join(sys.argv[3], "glyph_atlas.h"), atlas(sys.argv[1]))
+        write_if_changed(os.path.join(sys.argv[3], "icons.h"), icons(sys.argv[2]))
+else:
+    fonts_dir = os.path.join(env.subst("$PROJECT_LIBDEPS_DIR"), env.subst("$PIOENV"), "Adafruit GFX Library", "Fonts")
+    generated = os.path.join(env.subst("$BUILD_DIR"), "generated")
+    write_if_changed(os.path.join(generated, "glyph_atlas.h"), atlas(fonts_dir))
+    write_if_changed(os.path.join(generated, "icons.h"), icons(env.subst("$PROJECT_SRC_DIR/icons")))
+    env.Append(CPPPATH=[generated])